@@ -0,0 +1,396 @@
+// Microbenchmarks for the feed handler hot path, one component at a time:
+//   parse          Parser::parse, one message per call
+//   parse_batch    Parser::parse_batch, callback form
+//   parse_v2       Parser::parse_batch over the same stream in protocol v2
+//   parse_v2_batch same v2 stream in batch frames of BATCH_FRAME compact messages
+//   stream_buffer  StreamBuffer append (MSS sized chunks) + consume
+//   recv_parse     v2 stream in MSS sized reads through StreamBuffer + Parser::parse_batch
+//   capture        recv_parse with each read also appended to a TickJournal (files in /tmp)
+//   on_message     FeedHandler::on_message (seqlock + L2 book update)
+//   get_latest     FeedHandler::get_latest, random symbols
+//   on_msg_hooks   on_message with inline on_quote / on_trade hooks and no cache
+//   spmc_publish   BroadcastRing::publish with SPMC_CONSUMERS threads spinning on it
+//
+// usage: feed_handler_bench [messages] [repeats]
+// Each case runs `repeats` times over the same synthetic stream and reports
+// the best run. Counters come from perf_event_open when the kernel allows it.
+
+#include "feed_handler_impl.hpp"
+#include "parser.hpp"
+#include "stream_buffer.hpp"
+#include "perf_counters.hpp"
+#include "tick_journal.hpp"
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+struct FeedHandlerBench {
+    template <typename Handler = NullHandler>
+    static std::unique_ptr<BasicFeedHandler<Handler>> make() {
+        return std::unique_ptr<BasicFeedHandler<Handler>>(new BasicFeedHandler<Handler>());
+    }
+    template <typename Handler>
+    static void on_message(BasicFeedHandler<Handler>& fh, const MarketMessage& msg) {
+        fh.on_message(msg);
+    }
+};
+
+namespace {
+
+volatile uint64_t g_sink;   // keeps results observable to the optimizer
+
+// What an embedded strategy might keep instead of the cache
+struct VolumeHandler {
+    static constexpr bool use_cache = false;
+    uint64_t quotes{0};
+    uint64_t volume{0};
+    void on_quote(const MarketMessage&) { ++quotes; }
+    void on_trade(const MarketMessage& m) { volume += m.trade.trade_qty; }
+};
+
+struct Stream {
+    std::vector<MarketMessage> host;
+    std::vector<uint8_t> wire;
+    std::vector<uint8_t> wire_v2;
+    std::vector<uint8_t> wire_v2_batched;
+};
+
+constexpr size_t BATCH_FRAME = 64;   // messages per batch frame in wire_v2_batched
+
+// Same mix as the simulator: symbols 1..500, 70% quotes / 30% trades
+Stream make_stream(size_t n) {
+    Stream s;
+    s.host.resize(n);
+    s.wire.resize(n * sizeof(MarketMessage));
+
+    std::mt19937_64 rng(12345);
+    std::uniform_int_distribution<int> sym(1, 500);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_int_distribution<uint32_t> qty(1, 1000);
+
+    std::vector<uint64_t> sequence(501, 0);
+    for (size_t i = 0; i < n; ++i) {
+        MarketMessage& m = s.host[i];
+        std::memset(&m, 0, sizeof(m));
+        m.symbol_id = static_cast<uint16_t>(sym(rng));
+        m.sequence = ++sequence[m.symbol_id];   // per symbol, as the simulator numbers them
+        m.timestamp_ns = 1'000'000'000ULL + i * 1000;
+        const double mid = 100.0 + 4900.0 * unit(rng);
+        if (unit(rng) < 0.70) {
+            m.type = MessageType::QUOTE;
+            m.quote.bid_price = mid - 0.05;
+            m.quote.ask_price = mid + 0.05;
+            m.quote.bid_qty = qty(rng);
+            m.quote.ask_qty = qty(rng);
+        } else {
+            m.type = MessageType::TRADE;
+            m.trade.aggressor_buy = unit(rng) < 0.5;
+            m.trade.trade_price = m.trade.aggressor_buy ? mid + 0.05 : mid - 0.05;
+            m.trade.trade_qty = qty(rng);
+        }
+        const MarketMessage w = to_wire(m);
+        std::memcpy(&s.wire[i * sizeof(MarketMessage)], &w, sizeof(w));
+
+        uint8_t frame[v2::MAX_FRAME];
+        const size_t len = v2::encode(m, frame);
+        s.wire_v2.insert(s.wire_v2.end(), frame, frame + len);
+    }
+
+    // Batch frames over the v2 stream, encoded as the server does: header,
+    // then the next BATCH_FRAME frames, compact where their deltas fit
+    std::vector<uint64_t> last_sequence(v2::SEQUENCE_SLOTS, 0);
+    std::vector<uint8_t> frames;
+    size_t off = 0;
+    for (size_t i = 0; i < n; i += BATCH_FRAME) {
+        const size_t count = std::min(BATCH_FRAME, n - i);
+        const uint64_t base = s.host[i].timestamp_ns;
+        frames.clear();
+        for (size_t k = 0; k < count; ++k) {
+            const uint8_t* frame = s.wire_v2.data() + off;
+            const size_t len = v2::frame_size(s.host[i + k].type);
+            uint8_t compact[v2::MAX_FRAME];
+            const size_t compact_len = v2::encode_batched(frame, len, base, last_sequence.data(), compact);
+            if (compact_len != 0) {
+                frames.insert(frames.end(), compact, compact + compact_len);
+            } else {
+                frames.insert(frames.end(), frame, frame + len);
+            }
+            off += len;
+        }
+        const v2::BatchHeader h = v2::make_batch_header(
+            static_cast<uint16_t>(count), static_cast<uint32_t>(frames.size()), base, base);
+        const uint8_t* hb = reinterpret_cast<const uint8_t*>(&h);
+        s.wire_v2_batched.insert(s.wire_v2_batched.end(), hb, hb + sizeof(h));
+        s.wire_v2_batched.insert(s.wire_v2_batched.end(), frames.begin(), frames.end());
+    }
+    return s;
+}
+
+struct Result {
+    double ns{0};
+    int64_t cycles{-1};
+    int64_t instructions{-1};
+    int64_t cache_refs{-1};
+    int64_t cache_misses{-1};
+};
+
+// before() runs untimed ahead of every run
+template <typename Fn, typename Before>
+void run_case(const char* name, size_t msgs, int repeats, Fn&& fn, Before&& before) {
+    PerfCounters perf;
+    Result best;
+    best.ns = 1e300;
+
+    before();
+    fn();   // warm caches, page in buffers
+    for (int r = 0; r < repeats; ++r) {
+        before();
+        perf.start();
+        const auto t0 = std::chrono::steady_clock::now();
+        fn();
+        const auto t1 = std::chrono::steady_clock::now();
+        perf.stop();
+
+        const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+        if (ns < best.ns) {
+            best.ns = ns;
+            best.cycles = perf.value(PerfCounters::CYCLES);
+            best.instructions = perf.value(PerfCounters::INSTRUCTIONS);
+            best.cache_refs = perf.value(PerfCounters::CACHE_REFERENCES);
+            best.cache_misses = perf.value(PerfCounters::CACHE_MISSES);
+        }
+    }
+
+    const double per_msg = best.ns / static_cast<double>(msgs);
+    std::printf("%-14s %9.2f %10.2f", name, per_msg, 1e3 / per_msg);
+    if (best.cycles > 0 && best.instructions >= 0) {
+        std::printf(" %8.2f %6.2f",
+                    static_cast<double>(best.cycles) / msgs,
+                    static_cast<double>(best.instructions) / best.cycles);
+    } else {
+        std::printf(" %8s %6s", "n/a", "n/a");
+    }
+    if (best.cache_misses >= 0) {
+        std::printf(" %12.4f %10lld\n",
+                    static_cast<double>(best.cache_misses) / msgs,
+                    static_cast<long long>(best.cache_refs));
+    } else {
+        std::printf(" %12s %10s\n", "n/a", "n/a");
+    }
+}
+
+template <typename Fn>
+void run_case(const char* name, size_t msgs, int repeats, Fn&& fn) {
+    run_case(name, msgs, repeats, std::forward<Fn>(fn), [] {});
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : (1u << 20);
+    const int repeats = argc > 2 ? std::atoi(argv[2]) : 5;
+    if (n == 0 || repeats <= 0) {
+        std::fprintf(stderr, "usage: %s [messages] [repeats]\n", argv[0]);
+        return 1;
+    }
+
+    const Stream stream = make_stream(n);
+    const uint8_t* wire = stream.wire.data();
+    const size_t wire_len = stream.wire.size();
+
+    std::printf("messages=%zu repeats=%d (best run), wire bytes/msg v1=%.1f v2=%.1f v2 batched=%.1f\n",
+                n, repeats,
+                static_cast<double>(wire_len) / n,
+                static_cast<double>(stream.wire_v2.size()) / n,
+                static_cast<double>(stream.wire_v2_batched.size()) / n);
+    std::printf("%-14s %9s %10s %8s %6s %12s %10s\n",
+                "case", "ns/msg", "Mmsg/s", "cyc/msg", "IPC", "llc-miss/msg", "llc-refs");
+
+    run_case("parse", n, repeats, [&] {
+        Parser parser;
+        uint64_t sum = 0;
+        size_t off = 0;
+        while (true) {
+            ParseResult r = parser.parse(wire + off, wire_len - off);
+            if (r.status != ParseStatus::OK) {
+                break;
+            }
+            sum += r.message.symbol_id;
+            off += r.bytes_consumed;
+        }
+        g_sink = sum;
+    });
+
+    run_case("parse_batch", n, repeats, [&] {
+        Parser parser;
+        uint64_t sum = 0;
+        parser.parse_batch(wire, wire_len, [&](const MarketMessage& m) { sum += m.symbol_id; });
+        g_sink = sum;
+    });
+
+    run_case("parse_v2", n, repeats, [&] {
+        Parser parser;
+        uint64_t sum = 0;
+        parser.parse_batch(stream.wire_v2.data(), stream.wire_v2.size(),
+                           [&](const MarketMessage& m) { sum += m.symbol_id; });
+        g_sink = sum;
+    });
+
+    run_case("parse_v2_batch", n, repeats, [&] {
+        Parser parser;
+        uint64_t sum = 0;
+        parser.parse_batch(stream.wire_v2_batched.data(), stream.wire_v2_batched.size(),
+                           [&](const MarketMessage& m) { sum += m.symbol_id; },
+                           [&](const BatchInfo& b) { sum += b.count; });
+        g_sink = sum;
+    });
+
+    // TCP delivers MSS sized segments that split messages; consume whole ones
+    StreamBuffer buffer(256 * 1024);
+    run_case("stream_buffer", n, repeats, [&] {
+        constexpr size_t CHUNK = 1448;
+        uint64_t sum = 0;
+        for (size_t off = 0; off < wire_len; off += CHUNK) {
+            const size_t len = std::min(CHUNK, wire_len - off);
+            buffer.append(wire + off, len);
+            const size_t whole = buffer.data_size() / Parser::MESSAGE_SIZE * Parser::MESSAGE_SIZE;
+            sum += buffer.data_ptr()[0];
+            buffer.consume(whole);
+        }
+        buffer.consume(buffer.data_size());
+        g_sink = sum;
+    });
+
+    // What --capture adds to the network thread: recv_parse is the v2 stream
+    // arriving in MSS sized reads into a StreamBuffer and parsed, capture the
+    // same with every read appended to a journal first. The journal has the
+    // default 64 MiB files, so the runs rotate through several of them. A
+    // live feed fills a file in tens of seconds; here that takes milliseconds,
+    // so each run waits (untimed) for the journal thread's next file instead
+    // of dropping reads.
+    char dir_template[] = "/tmp/fh_bench_XXXXXX";
+    if (const char* dir = mkdtemp(dir_template)) {
+        constexpr size_t CHUNK = 1448;
+        const uint8_t* v2 = stream.wire_v2.data();
+        const size_t v2_len = stream.wire_v2.size();
+        auto recv_parse = [&](TickJournal* journal) {
+            Parser parser;
+            uint64_t sum = 0;
+            for (size_t off = 0; off < v2_len; off += CHUNK) {
+                const size_t len = std::min(CHUNK, v2_len - off);
+                if (journal != nullptr) {
+                    journal->append(JournalSource::TCP, v2 + off, len, off);
+                }
+                buffer.append(v2 + off, len);
+                buffer.consume(parser.parse_batch(buffer.data_ptr(), buffer.data_size(),
+                                                  [&](const MarketMessage& m) { sum += m.symbol_id; }));
+            }
+            buffer.consume(buffer.data_size());
+            g_sink = sum;
+        };
+        run_case("recv_parse", n, repeats, [&] { recv_parse(nullptr); });
+
+        uint64_t dropped = 0;
+        uint64_t files = 0;
+        {
+            JournalConfig config;
+            config.directory = dir;
+            TickJournal journal(config);
+            run_case("capture", n, repeats, [&] { recv_parse(&journal); }, [&] {
+                while (!journal.spare_ready()) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            });
+            dropped = journal.dropped();
+            files = journal.files();
+        }
+        std::printf("  capture used %llu files, dropped %llu reads\n",
+                    static_cast<unsigned long long>(files), static_cast<unsigned long long>(dropped));
+        if (DIR* d = opendir(dir)) {
+            while (dirent* e = readdir(d)) {
+                if (e->d_name[0] != '.') {
+                    unlink((std::string(dir) + "/" + e->d_name).c_str());
+                }
+            }
+            closedir(d);
+        }
+        rmdir(dir);
+    }
+
+    std::unique_ptr<FeedHandler> fh = FeedHandlerBench::make();
+    run_case("on_message", n, repeats, [&] {
+        for (const MarketMessage& m : stream.host) {
+            FeedHandlerBench::on_message(*fh, m);
+        }
+    });
+
+    std::vector<uint16_t> lookups(n);
+    std::mt19937_64 rng(54321);
+    std::uniform_int_distribution<int> sym(1, 500);
+    for (auto& s : lookups) {
+        s = static_cast<uint16_t>(sym(rng));
+    }
+    const FeedHandler& reader = *fh;
+    run_case("get_latest", n, repeats, [&] {
+        uint64_t sum = 0;
+        MarketMessage out;
+        for (uint16_t s : lookups) {
+            if (reader.get_latest(s, out)) {
+                sum += out.sequence;
+            }
+        }
+        g_sink = sum;
+    });
+
+    auto hooked = FeedHandlerBench::make<VolumeHandler>();
+    run_case("on_msg_hooks", n, repeats, [&] {
+        for (const MarketMessage& m : stream.host) {
+            FeedHandlerBench::on_message(*hooked, m);
+        }
+        g_sink = hooked->handler().volume + hooked->handler().quotes;
+    });
+
+    // Producer cost with live consumers: cache lines bounce between cores
+    constexpr int SPMC_CONSUMERS = 2;
+    BroadcastRing ring;
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> consumers;
+    for (int c = 0; c < SPMC_CONSUMERS; ++c) {
+        BroadcastRing::Consumer* consumer = ring.subscribe("bench-" + std::to_string(c));
+        consumers.emplace_back([consumer, &stop] {
+            uint64_t sum = 0;
+            MarketMessage m;
+            while (consumer->next_spin(m, stop)) {
+                sum += m.sequence;
+            }
+            g_sink = sum;
+        });
+    }
+    run_case("spmc_publish", n, repeats, [&] {
+        for (const MarketMessage& m : stream.host) {
+            ring.publish(m);
+        }
+    });
+    stop.store(true);
+    for (auto& t : consumers) {
+        t.join();
+    }
+    for (const ConsumerStats& c : ring.consumer_stats()) {
+        std::printf("  %s consumed %llu overruns %llu\n", c.name.c_str(),
+                    static_cast<unsigned long long>(c.consumed),
+                    static_cast<unsigned long long>(c.overruns));
+    }
+
+    return 0;
+}
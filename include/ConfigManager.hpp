@@ -5,9 +5,12 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/ini_parser.hpp>
 #include <filesystem>
+#include <algorithm>
 #include <cinttypes>
 #include <iostream>
 #include <string>
+#include <sstream>
+#include <vector>
 
 
 constexpr int SUCCESS = 0;
@@ -21,6 +24,10 @@ static constexpr uint16_t MAX_SYMBOL_ID=500;
 static constexpr uint16_t MIN_SYMBOL_ID=1;
 static constexpr double MSGQuoteRatio = 0.70;
 static constexpr double MSGTradeRatio = 0.30;
+static constexpr uint32_t MAX_BATCH_BYTES = 512 * 1024;
+static constexpr uint32_t MAX_DEPTH_LEVELS = 10;
+static constexpr uint32_t MAX_RECOVERY_DEPTH = 8192;   // 501 symbols x 8192 x 44 B: ~180 MB of RetransmitStore
+static constexpr uint32_t MIN_CLIENT_QUEUE_BYTES = 64 * 1024;
 enum class RunMode{
     Random, Manual
 };
@@ -49,9 +56,20 @@ class ConfigManager{
 
     void LoadParameters(){
         m_numOfThreads = m_ptree.get<int>("SERVER.THREADS", 4);
+        m_networkCore = m_ptree.get<int>("SERVER.NETWORK_CORE", 2);
+        m_spinLoop = m_ptree.get<std::string>("SERVER.LOOPMODE", "BLOCK") == "SPIN";
+        m_workerCores = ParseCoreList(m_ptree.get<std::string>("SERVER.WORKER_CORES", ""));
         m_numOfSymbols = m_ptree.get<int>("EXCHANGE.SYMBOLS", 100);
         m_port = m_ptree.get<int>("SERVER.PORT",9876);
         m_ipadd = m_ptree.get<std::string>("SERVER.SERVER_IP_ADD", "0.0.0.0");
+        m_recoveryPort = m_ptree.get<int>("SERVER.RECOVERY_PORT", 9877);
+        m_controlPort = m_ptree.get<int>("SERVER.CONTROL_PORT", 0);
+        m_recoveryDepth = m_ptree.get<uint32_t>("RECOVERY.DEPTH", 1024);
+        m_multicastEnabled = m_ptree.get<int>("MULTICAST.ENABLED", 0) != 0;
+        m_multicastGroup = m_ptree.get<std::string>("MULTICAST.GROUP", "239.255.0.1");
+        m_multicastPort = m_ptree.get<int>("MULTICAST.PORT", 9878);
+        m_multicastInterface = m_ptree.get<std::string>("MULTICAST.INTERFACE", "127.0.0.1");
+        m_multicastTTL = m_ptree.get<int>("MULTICAST.TTL", 1);
         m_marketDrift = m_ptree.get<double>("MARKET.DRIFT", 0.0);
 
 
@@ -64,12 +82,36 @@ class ConfigManager{
         m_volatilityMax = m_ptree.get<double>("MARKET.VOLATILITYMAX", 0.01);
         m_volatilityMin =m_ptree.get<double>("MARKET.VOLATILITYMIN", 0.06);
 
-        m_tickRateMax = m_ptree.get<uint32_t>("TICKS.RATEMAX", 10000);
-        m_tickRateMin = m_ptree.get<uint32_t>("TICKS.RATEMIN", 500000);
+        m_tickRateMax = m_ptree.get<uint32_t>("TICKS.RATEMAX", 500000);
+        m_tickRateMin = m_ptree.get<uint32_t>("TICKS.RATEMIN", 10000);
+        m_tickRatePeak = m_ptree.get<uint32_t>("TICKS.RATEPEAK", 5000000);
         m_ticksRate = m_ptree.get<uint32_t>("TICKS.TICKSRATE", 50000);
+        m_loadProfile = m_ptree.get<std::string>("TICKS.PROFILE", "CONSTANT");
+        m_profilePeriodSec = m_ptree.get<double>("TICKS.PROFILE_PERIOD_SEC", 10.0);
+        m_profileSteps = m_ptree.get<uint32_t>("TICKS.PROFILE_STEPS", 5);
+        m_burstMultiplier = m_ptree.get<uint32_t>("TICKS.BURST_MULTIPLIER", 10);
+        m_burstDurationMs = m_ptree.get<uint32_t>("TICKS.BURST_DURATION_MS", 500);
 
         m_runDurationSec = m_ptree.get<uint64_t>("TICKS.m_runDurationSec", 1);
         m_dt = m_ptree.get<double>("TICKS.dT", 0.001);
+        m_scalarKernel = m_ptree.get<std::string>("TICKS.KERNEL", "BATCH") == "SCALAR";
+        m_depthLevels = m_ptree.get<uint32_t>("TICKS.DEPTHLEVELS", 1);
+
+        m_faultsEnabled = m_ptree.get<int>("FAULTS.ENABLED", 0) != 0;
+        m_faultDrop = m_ptree.get<double>("FAULTS.DROP", 0.0);
+        m_faultDuplicate = m_ptree.get<double>("FAULTS.DUPLICATE", 0.0);
+        m_faultReorder = m_ptree.get<double>("FAULTS.REORDER", 0.0);
+        m_faultCorrupt = m_ptree.get<double>("FAULTS.CORRUPT", 0.0);
+        m_faultSplit = m_ptree.get<double>("FAULTS.SPLIT", 0.0);
+        m_faultThrottleKBps = m_ptree.get<uint32_t>("FAULTS.THROTTLE_KBPS", 0);
+
+        m_clientQueueBytes = m_ptree.get<uint32_t>("SLOWCONSUMER.QUEUE_BYTES", 1048576);
+        m_conflateHighWater = m_ptree.get<uint32_t>("SLOWCONSUMER.CONFLATE_HIGH_WATER", 262144);
+        m_conflateLowWater = m_ptree.get<uint32_t>("SLOWCONSUMER.CONFLATE_LOW_WATER", 32768);
+        m_conflateMaxMs = m_ptree.get<uint32_t>("SLOWCONSUMER.CONFLATE_MAX_MS", 5000);
+
+        m_maxBatchBytes = m_ptree.get<uint32_t>("BATCH.MAXBYTES", 16384);
+        m_maxBatchDelayUs = m_ptree.get<uint32_t>("BATCH.MAXDELAYUS", 100);
     }
     
     void setRandomMode(char runMode){
@@ -100,12 +142,29 @@ class ConfigManager{
     }
 
     private:
+    // "3,4,5" -> {3,4,5}; empty or malformed entries are skipped
+    static std::vector<int> ParseCoreList(const std::string& list){
+        std::vector<int> cores;
+        std::stringstream ss(list);
+        std::string item;
+        while(std::getline(ss, item, ',')){
+            try{
+                cores.push_back(std::stoi(item));
+            }
+            catch(const std::exception&){
+                std::cerr<<"Ignoring invalid core id : "<<item<<"\n";
+            }
+        }
+        return cores;
+    }
+
     void ValidateConfigParameters(){
         //thread validation
         if(m_numOfThreads>MAX_THREADS){
         std::cout<<"Reduce the Number of threads in INI"<<"\n";
+        m_numOfThreads=MAX_THREADS;
         }
-        else if(m_numOfThreads==0){
+        else if(m_numOfThreads<=0){
         m_numOfThreads=4;
         std::cout<<"Fall back TO default number of threads"<<"\n";
         }
@@ -142,13 +201,104 @@ class ConfigManager{
             exit(FAIL);
         }
 
-        if(m_tickRateMax>m_tickRateMin){
+        if(m_tickRateMax>m_tickRateMin && m_tickRateMin>0){
             std::cout<<"Max Ticks: "<<m_tickRateMax<<"\n"<<"Min Ticks: "<<m_tickRateMin<<"\n";
         }
         else {
             std::cerr<<"Invalid Ticks "<<"\n";
+            m_tickRateMin=10000;
+            m_tickRateMax=500000;
+            std::cout<<"Fall back TO default tick rate range"<<"\n";
+        }
+        //every rate the simulator runs at, static or profiled, stays inside [RATEMIN, RATEMAX]
+        if(m_ticksRate<m_tickRateMin || m_ticksRate>m_tickRateMax){
+            m_ticksRate=std::clamp(m_ticksRate, m_tickRateMin, m_tickRateMax);
+            std::cout<<"Tick rate clamped TO "<<m_ticksRate<<"\n";
+        }
+        if(m_loadProfile!="CONSTANT" && m_loadProfile!="STEP" && m_loadProfile!="SINE" && m_loadProfile!="BURST"){
+            m_loadProfile="CONSTANT";
+            std::cout<<"Fall back TO constant load profile"<<"\n";
+        }
+        if(m_profilePeriodSec<=0.0){
+            m_profilePeriodSec=10.0;
+            std::cout<<"Fall back TO default profile period"<<"\n";
         }
+        if(m_burstMultiplier==0){
+            m_burstMultiplier=10;
+            std::cout<<"Fall back TO default burst multiplier"<<"\n";
+        }
+        //bursts and spikes multiply the profile rate up to RATEPEAK
+        if(m_tickRatePeak<m_tickRateMax){
+            m_tickRatePeak=m_tickRateMax;
+            std::cout<<"Peak rate raised TO "<<m_tickRatePeak<<"\n";
+        }
+        if(m_loadProfile=="BURST" && static_cast<uint64_t>(m_ticksRate)*m_burstMultiplier>m_tickRatePeak){
+            std::cout<<"Warning: bursts capped AT RATEPEAK "<<m_tickRatePeak<<", "
+                     <<static_cast<double>(m_tickRatePeak)/m_ticksRate<<"x instead of "<<m_burstMultiplier<<"x\n";
+        }
+        std::cout<<"Load Profile: "<<m_loadProfile<<" period(s) "<<m_profilePeriodSec<<"\n";
+        std::cout<<"Control Port: "<<m_controlPort<<"\n";
         std::cout<<"Stop Time: "<<m_runDurationSec<<"\n";
+        std::cout<<"Loop Mode: "<<(m_spinLoop ? "SPIN" : "BLOCK")<<"\n";
+
+        if(m_maxBatchBytes==0 || m_maxBatchBytes>MAX_BATCH_BYTES){
+            m_maxBatchBytes=16384;
+            std::cout<<"Fall back TO default batch size"<<"\n";
+        }
+        if(m_depthLevels==0 || m_depthLevels>MAX_DEPTH_LEVELS){
+            m_depthLevels=1;
+            std::cout<<"Fall back TO top of book quotes"<<"\n";
+        }
+        std::cout<<"Depth Levels: "<<m_depthLevels<<"\n";
+
+        //ring per symbol is indexed by sequence & (depth-1): power of two only
+        if(m_recoveryDepth==0 || m_recoveryDepth>MAX_RECOVERY_DEPTH || (m_recoveryDepth & (m_recoveryDepth-1))!=0){
+            m_recoveryDepth=1024;
+            std::cout<<"Fall back TO default recovery depth"<<"\n";
+        }
+        std::cout<<"Recovery Port: "<<m_recoveryPort<<"\n"<<"Recovery Depth: "<<m_recoveryDepth<<"\n";
+
+        if(m_multicastEnabled){
+            if(m_multicastPort<=0 || m_multicastPort>65535){
+                m_multicastPort=9878;
+                std::cout<<"Fall back TO default multicast port"<<"\n";
+            }
+            if(m_multicastTTL<0 || m_multicastTTL>255){
+                m_multicastTTL=1;
+                std::cout<<"Fall back TO default multicast TTL"<<"\n";
+            }
+            std::cout<<"Multicast: "<<m_multicastGroup<<":"<<m_multicastPort
+                     <<" via "<<m_multicastInterface<<" ttl "<<m_multicastTTL<<"\n";
+        }
+
+        if(m_clientQueueBytes<MIN_CLIENT_QUEUE_BYTES){
+            m_clientQueueBytes=1048576;
+            std::cout<<"Fall back TO default client queue size"<<"\n";
+        }
+        //conflating must start before the queue is full and stop below where it started
+        if(m_conflateHighWater!=0 &&
+           (m_conflateHighWater>=m_clientQueueBytes || m_conflateLowWater>=m_conflateHighWater)){
+            m_conflateHighWater=m_clientQueueBytes/4;
+            m_conflateLowWater=m_clientQueueBytes/32;
+            std::cout<<"Fall back TO default conflation water marks"<<"\n";
+        }
+        std::cout<<"Client Queue: "<<m_clientQueueBytes<<" conflate at "<<m_conflateHighWater
+                 <<" until "<<m_conflateLowWater<<" for at most "<<m_conflateMaxMs<<" ms\n";
+
+        if(m_faultsEnabled){
+            //probabilities outside [0,1] are a typo, not a request for certainty
+            for(double* p : {&m_faultDrop, &m_faultDuplicate, &m_faultReorder, &m_faultCorrupt, &m_faultSplit}){
+                if(*p<0.0 || *p>1.0){
+                    *p=0.0;
+                    std::cout<<"Fall back TO no fault for an invalid probability"<<"\n";
+                }
+            }
+            std::cout<<"Faults: drop "<<m_faultDrop<<" duplicate "<<m_faultDuplicate
+                     <<" reorder "<<m_faultReorder<<" corrupt "<<m_faultCorrupt
+                     <<" split "<<m_faultSplit<<" throttle(KB/s) "<<m_faultThrottleKBps<<"\n";
+        }
+
+        std::cout<<"Batch Bytes: "<<m_maxBatchBytes<<"\n"<<"Batch Delay(us): "<<m_maxBatchDelayUs<<"\n";
         // if(m_msgQuoteRatio+m_msgTradeRatio-1>=EPS){
         //     std::cerr<<"Invalid Ratio's"<<"\n";
         // }
@@ -167,14 +317,33 @@ class ConfigManager{
         double m_spreadMax;
         std::string m_ipadd;
         int m_port;
-
-        int m_numOfThreads;
+        int m_recoveryPort;           // retransmit side channel, 0 = disabled
+        int m_controlPort;            // text control channel (RATE/PROFILE/SPIKE/STATUS), 0 = disabled
+        uint32_t m_recoveryDepth;     // messages kept per symbol for retransmission
+        bool m_multicastEnabled;      // MULTICAST.ENABLED: publish every tick to a UDP group as well
+        std::string m_multicastGroup;
+        int m_multicastPort;
+        std::string m_multicastInterface; // local address the group is sent from
+        int m_multicastTTL;           // 0 = this host only
+
+        int m_numOfThreads;           // tick generator (worker) threads
+        int m_networkCore;            // core for the epoll/broadcast thread, -1 = unpinned
+        bool m_spinLoop;              // SERVER.LOOPMODE: BLOCK (epoll timeout, sleeping workers) or SPIN
+        std::vector<int> m_workerCores; // worker i is pinned to m_workerCores[i % size], empty = unpinned
         int m_numOfSymbols;
 
         uint32_t m_tickRateMin;
         uint32_t m_tickRateMax;
+        uint32_t m_tickRatePeak;      // TICKS.RATEPEAK: ceiling of BURST and SPIKE, >= RATEMAX
         uint32_t m_ticksRate;
+        std::string m_loadProfile;    // TICKS.PROFILE: CONSTANT, STEP, SINE or BURST
+        double m_profilePeriodSec;    // one STEP staircase / SINE cycle / BURST interval
+        uint32_t m_profileSteps;      // STEP: levels between RATEMIN and RATEMAX
+        uint32_t m_burstMultiplier;   // BURST: rate multiplier while bursting
+        uint32_t m_burstDurationMs;   // BURST: burst length at the start of every period
         double m_dt;
+        bool m_scalarKernel;          // TICKS.KERNEL: BATCH (SIMD) or SCALAR (reference), same output
+        uint32_t m_depthLevels;       // TICKS.DEPTHLEVELS: price levels per side, 1 = top of book only
 
         char m_runMode;
 
@@ -189,6 +358,22 @@ class ConfigManager{
 
         double m_marketDrift;
         uint64_t m_runDurationSec ;
+
+        bool m_faultsEnabled;         // FAULTS.ENABLED: adversarial delivery to TCP clients
+        double m_faultDrop;           // per message probabilities
+        double m_faultDuplicate;
+        double m_faultReorder;
+        double m_faultCorrupt;
+        double m_faultSplit;          // per send probability of stopping mid message
+        uint32_t m_faultThrottleKBps; // per client send cap, 0 = unthrottled
+
+        uint32_t m_clientQueueBytes;  // pending bytes per client before it is disconnected
+        uint32_t m_conflateHighWater; // pending bytes that switch a client to conflated quotes, 0 = never
+        uint32_t m_conflateLowWater;  // pending bytes at which it gets the full feed again
+        uint32_t m_conflateMaxMs;     // conflated longer than this: disconnected, 0 = no limit
+
+        uint32_t m_maxBatchBytes;     // flush a client once this many bytes are pending
+        uint32_t m_maxBatchDelayUs;   // flush everything once the oldest pending tick is this old
         // uint32_t m_rng_seed;
 
 };
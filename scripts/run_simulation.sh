@@ -12,6 +12,10 @@ FEED_BIN="$BIN_DIR/feedhandler"
 SIM_CPU=2
 CLIENT_CPUS=(3 4 5 6)
 
+# Extra feed handler arguments, e.g. FEED_ARGS=--multicast to take data from
+# the simulator's multicast group (needs MULTICAST.ENABLED = 1)
+FEED_ARGS="${FEED_ARGS:-}"
+
 LOG_DIR="$ROOT_DIR/scripts/logs"
 mkdir -p "$LOG_DIR"
 
@@ -39,7 +43,7 @@ echo "[INFO] Starting FeedHandlers..."
 for CPU in "${CLIENT_CPUS[@]}"; do
     echo "  → FeedHandler on CPU $CPU"
     cd "$ROOT_DIR"
-    taskset -c "$CPU" "$FEED_BIN" \
+    taskset -c "$CPU" "$FEED_BIN" $FEED_ARGS \
         > "$LOG_DIR/feedhandler_cpu${CPU}.log" 2>&1 &
     sleep 0.3
 done
@@ -0,0 +1,124 @@
+#include "broadcast_ring.hpp"
+
+BroadcastRing::BroadcastRing(size_t capacity) : mask_(capacity - 1) {}
+
+BroadcastRing::Consumer::Consumer(BroadcastRing& ring, std::string name, uint64_t start)
+    : ring_(ring), name_(std::move(name)), cursor_(start) {}
+
+bool BroadcastRing::Consumer::try_read(MarketMessage& out) {
+    const uint64_t seq = cursor_.load(std::memory_order_relaxed);
+    const Slot& slot = ring_.slots_[seq & ring_.mask_];
+
+    if (slot.sequence.load(std::memory_order_acquire) == seq + 1) {
+        out = slot.msg;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == seq + 1) {
+            cursor_.store(seq + 1, std::memory_order_relaxed);
+            consumed_.store(consumed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // The slot is written before published_ moves past it. Less than a
+    // ring ahead, the producer published seq after our first look; a whole
+    // ring ahead, it has overwritten (or is overwriting) the slot.
+    const uint64_t head = ring_.published_.load(std::memory_order_acquire);
+    if (head <= seq) {
+        return false;
+    }
+    if (head - seq < ring_.capacity()) {
+        return try_read(out);
+    }
+    const uint64_t resume = head - ring_.capacity() / 2;
+    overruns_.store(overruns_.load(std::memory_order_relaxed) + (resume - seq), std::memory_order_relaxed);
+    cursor_.store(resume, std::memory_order_relaxed);
+    return try_read(out);
+}
+
+bool BroadcastRing::Consumer::next_spin(MarketMessage& out, const std::atomic<bool>& stop) {
+    while (!try_read(out)) {
+        if (stop.load(std::memory_order_relaxed)) {
+            return false;
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+    return true;
+}
+
+// Announce the sleep, then re-check under the lock: the producer either
+// sees sleepers_ != 0 after publishing, or we see its message here
+bool BroadcastRing::Consumer::next_wait(MarketMessage& out, std::chrono::microseconds timeout) {
+    if (try_read(out)) {
+        return true;
+    }
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        ring_.sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(ring_.wait_mutex_);
+            if (ring_.published_.load(std::memory_order_seq_cst) <= cursor_.load(std::memory_order_relaxed)) {
+                ring_.wait_cv_.wait_until(lock, deadline);
+            }
+        }
+        ring_.sleepers_.fetch_sub(1, std::memory_order_relaxed);
+
+        if (try_read(out)) {
+            return true;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+    }
+}
+
+uint64_t BroadcastRing::Consumer::lag() const {
+    const uint64_t head = ring_.published_.load(std::memory_order_acquire);
+    const uint64_t cursor = cursor_.load(std::memory_order_relaxed);
+    return head > cursor ? head - cursor : 0;
+}
+
+void BroadcastRing::notify_sleepers() {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    wait_cv_.notify_all();
+}
+
+BroadcastRing::Consumer* BroadcastRing::subscribe(const std::string& name) {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    for (auto& consumer : consumers_) {
+        if (consumer) {
+            continue;
+        }
+        if (!slots_) {
+            slots_.reset(new Slot[mask_ + 1]);
+        }
+        consumer.reset(new Consumer(*this, name, published_.load(std::memory_order_acquire)));
+        // Release: the producer only touches slots_ once it sees a consumer
+        active_.fetch_add(1, std::memory_order_release);
+        return consumer.get();
+    }
+    return nullptr;
+}
+
+void BroadcastRing::unsubscribe(Consumer* consumer) {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    for (auto& slot : consumers_) {
+        if (slot.get() == consumer) {
+            slot.reset();
+            active_.fetch_sub(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+std::vector<ConsumerStats> BroadcastRing::consumer_stats() const {
+    std::vector<ConsumerStats> stats;
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    for (const auto& consumer : consumers_) {
+        if (consumer) {
+            stats.push_back({consumer->name(), consumer->consumed(), consumer->lag(), consumer->overruns()});
+        }
+    }
+    return stats;
+}
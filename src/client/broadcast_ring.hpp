@@ -0,0 +1,146 @@
+#ifndef BROADCAST_RING_H
+#define BROADCAST_RING_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../common/protocol.hpp"
+
+struct ConsumerStats {
+    std::string name;
+    uint64_t consumed{0};
+    uint64_t lag{0};        // published but not yet read
+    uint64_t overruns{0};   // skipped after being lapped
+};
+
+// Single producer / multi consumer broadcast ring: every consumer sees
+// every published message, in order. Disruptor style: one shared array of
+// slots and one cursor per consumer, nothing is copied per consumer.
+//
+// Unlike a Disruptor the producer never waits for consumers (it is the feed
+// handler's network thread). A consumer that falls CAPACITY behind is
+// lapped: it notices when it reads, jumps to half a ring behind the
+// producer and counts what it skipped as overruns.
+//
+// Each slot carries the sequence it holds (+1, 0 while being rewritten),
+// so a read is a seqlock: check, copy, check again.
+class BroadcastRing {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 16;   // power of two
+    static constexpr size_t MAX_CONSUMERS = 16;
+
+    class Consumer {
+    public:
+        // Up to max messages to fn(const MarketMessage&) without waiting;
+        // returns how many
+        template <typename Fn>
+        size_t poll(Fn&& fn, size_t max = SIZE_MAX) {
+            MarketMessage msg;
+            size_t n = 0;
+            while (n < max && try_read(msg)) {
+                fn(static_cast<const MarketMessage&>(msg));
+                ++n;
+            }
+            return n;
+        }
+
+        bool try_read(MarketMessage& out);
+
+        // Busy-waits for the next message; false once stop is set
+        bool next_spin(MarketMessage& out, const std::atomic<bool>& stop);
+
+        // Sleeps until the next message or the timeout; false on timeout
+        bool next_wait(MarketMessage& out, std::chrono::microseconds timeout);
+
+        const std::string& name() const { return name_; }
+        uint64_t consumed() const { return consumed_.load(std::memory_order_relaxed); }
+        uint64_t overruns() const { return overruns_.load(std::memory_order_relaxed); }
+        uint64_t lag() const;
+
+    private:
+        friend class BroadcastRing;
+        Consumer(BroadcastRing& ring, std::string name, uint64_t start);
+
+        BroadcastRing& ring_;
+        std::string name_;
+        alignas(64) std::atomic<uint64_t> cursor_;   // next sequence to read
+        std::atomic<uint64_t> consumed_{0};
+        std::atomic<uint64_t> overruns_{0};
+    };
+
+    explicit BroadcastRing(size_t capacity = DEFAULT_CAPACITY);
+
+    BroadcastRing(const BroadcastRing&) = delete;
+    BroadcastRing& operator=(const BroadcastRing&) = delete;
+
+    // ---- producer (one thread) ----
+
+    // Free while nobody is subscribed
+    void publish(const MarketMessage& msg) {
+        if (active_.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+        const uint64_t seq = next_;
+        Slot& slot = slots_[seq & mask_];
+        slot.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.msg = msg;
+        slot.sequence.store(seq + 1, std::memory_order_release);
+        next_ = seq + 1;
+        published_.store(seq + 1, std::memory_order_release);
+    }
+
+    // Once per batch of publish() calls: wakes next_wait() sleepers. Only
+    // takes the lock when a consumer is actually asleep.
+    void wake_waiters() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_relaxed) != 0) {
+            notify_sleepers();
+        }
+    }
+
+    // ---- consumers (any thread) ----
+
+    // Starts at the next message published; nullptr if MAX_CONSUMERS are taken.
+    // The consumer stays valid until unsubscribe() or the ring's destruction.
+    Consumer* subscribe(const std::string& name);
+    void unsubscribe(Consumer* consumer);
+
+    std::vector<ConsumerStats> consumer_stats() const;
+
+    size_t capacity() const { return mask_ + 1; }
+    uint64_t published() const { return published_.load(std::memory_order_acquire); }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> sequence{0};   // held sequence + 1, 0 = empty / being written
+        MarketMessage msg;
+    };
+
+    void notify_sleepers();
+
+    std::unique_ptr<Slot[]> slots_;   // allocated by the first subscribe()
+    const size_t mask_;
+
+    // producer
+    alignas(64) uint64_t next_{0};
+    std::atomic<uint64_t> published_{0};   // sequences below this are readable
+    std::atomic<uint32_t> active_{0};      // subscribed consumers
+
+    // consumers
+    alignas(64) std::atomic<uint32_t> sleepers_{0};
+    std::mutex wait_mutex_;
+    std::condition_variable wait_cv_;
+
+    mutable std::mutex registry_mutex_;
+    std::unique_ptr<Consumer> consumers_[MAX_CONSUMERS];
+};
+
+#endif
@@ -3,12 +3,25 @@
 
 #include <unordered_map>
 #include <vector>
+#include <deque>
 #include <cstdint>
 #include <atomic>
 #include <string>
 #include <array>
+#include <bitset>
+#include <chrono>
+#include <mutex>
+#include <memory>
 
 #include "parser.hpp"
+#include "stream_buffer.hpp"
+#include "order_book.hpp"
+#include "latency_histogram.hpp"
+#include "recovery_channel.hpp"
+#include "uring_receiver.hpp"
+#include "broadcast_ring.hpp"
+#include "message_handler.hpp"
+#include "tick_journal.hpp"
 #include "../common/protocol.hpp"
 #include "market_data_socket.hpp"
 
@@ -21,84 +34,288 @@
 //     bool has_data{false};
 // };
 
+// Last message and L2 book of one symbol, published under one seqlock.
+// epoch is the connection the data arrived on; older epochs are stale.
 struct alignas(64) SymbolState {
     std::atomic<uint64_t> version{0};
+    std::atomic<uint32_t> epoch{0};
     MarketMessage data;
+    OrderBook book;
 };
 
+enum class ConnectionState : uint8_t {
+    CONNECTING,   // non-blocking connect in flight
+    CONNECTED,    // subscribed and receiving
+    BACKOFF       // waiting for the next reconnect attempt
+};
 
-struct StreamBuffer {
-    std::vector<uint8_t> buffer;
-    size_t offset{0};
+// How bytes get off the TCP socket
+enum class ReceiveMode : uint8_t {
+    EPOLL,      // edge-triggered epoll + recv() (default)
+    IO_URING,   // multishot recv into registered buffers, ring fd polled by epoll
+    BUSY_POLL   // SO_BUSY_POLL and a spinning recv(); burns the core, lowest tail latency
+};
 
-    StreamBuffer() {
-        buffer.reserve(64 * 1024);
+// Handler: hooks called inline for every message (see message_handler.hpp).
+// Member definitions are in feed_handler_impl.hpp; FeedHandler (no hooks)
+// is instantiated once in feed_handler.cpp, an application with its own
+// handler includes feed_handler_impl.hpp itself.
+template <typename Handler = NullHandler>
+class BasicFeedHandler {
+public:
+    uint64_t message_count() const {
+        return messages_.load(std::memory_order_relaxed);
     }
 
-    explicit StreamBuffer(size_t reserve_bytes = 64 * 1024) {
-        buffer.reserve(reserve_bytes);
+    // Messages missing from the live feed (per-symbol sequence jumps)
+    uint64_t sequence_gaps() const {
+        return seq_gaps_.load(std::memory_order_relaxed);
     }
 
-    void append(const uint8_t* data, size_t len) {
-        buffer.insert(buffer.end(), data, data + len);
+    // Of those, how many the retransmit channel delivered / could not deliver
+    uint64_t recovered_count() const { return recovery_.recovered(); }
+    uint64_t lost_count() const { return recovery_.lost(); }
+
+    // Ticks older than one already applied (duplicates, reordered); dropped
+    uint64_t duplicate_count() const {
+        return duplicates_.load(std::memory_order_relaxed);
     }
 
-    const uint8_t* data_ptr() const {
-        return buffer.data() + offset;
+    // Top-of-book snapshots applied (one per symbol on every (re)subscribe)
+    uint64_t snapshot_count() const {
+        return snapshots_.load(std::memory_order_relaxed);
     }
 
-    size_t data_size() const {
-        return buffer.size() - offset;
+    // Sequences the server withheld while it conflated us (GAP_FILL); not gaps
+    uint64_t withheld_count() const {
+        return withheld_.load(std::memory_order_relaxed);
     }
 
-    void consume(size_t n) {
-        offset += n;
+    // Exchange timestamp -> cache publish latency, written by the network thread
+    const LatencyHistogram& latency_histogram() const {
+        return latency_;
+    }
 
-        if (offset > 0 && offset >= buffer.size() / 2) {
-            buffer.erase(buffer.begin(), buffer.begin() + offset);
-            offset = 0;
-        }
+    // Batch frames received and the messages they carried (batch mode only)
+    uint64_t batch_count() const {
+        return batches_.load(std::memory_order_relaxed);
+    }
+    uint64_t batched_message_count() const {
+        return batched_messages_.load(std::memory_order_relaxed);
     }
-};
 
-class FeedHandler {
-public:
-    uint64_t message_count() const {
-        return messages_.load(std::memory_order_relaxed);
+    // Server flush -> batch header decoded, one sample per batch
+    const LatencyHistogram& batch_latency_histogram() const {
+        return batch_latency_;
     }
 
-    uint64_t sequence_gaps() const {
-        return seq_gaps_.load(std::memory_order_relaxed);
+    // Symbols currently subscribed, as last applied by the network thread
+    size_t subscribed_count() const {
+        return subscribed_count_.load(std::memory_order_relaxed);
+    }
+
+    // Connection health for the UI thread
+    ConnectionState connection_state() const {
+        return conn_state_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t reconnect_count() const {
+        return reconnects_.load(std::memory_order_relaxed);
+    }
+
+    // Multicast mode: datagrams received and datagrams missing (packet
+    // sequence jumps); lost ticks still surface as per-symbol gaps
+    bool multicast_enabled() const { return multicast_; }
+    uint64_t multicast_packet_count() const {
+        return mcast_packets_.load(std::memory_order_relaxed);
+    }
+    uint64_t packet_gaps() const {
+        return mcast_packet_gaps_.load(std::memory_order_relaxed);
     }
 
-    FeedHandler(const std::string& host, uint16_t port);
+    // recovery_port: simulator's SERVER.RECOVERY_PORT, 0 disables recovery
+    // wire_version: feed protocol requested at subscription (v1 or v2)
+    // batch_frames: ask for one batch frame per server flush (v2 only)
+    // receive_mode: IO_URING falls back to EPOLL if the kernel refuses it
+    BasicFeedHandler(const std::string& host, uint16_t port,
+                     uint16_t recovery_port = 9877,
+                     uint8_t wire_version = PROTOCOL_VERSION_2,
+                     bool batch_frames = true,
+                     ReceiveMode receive_mode = ReceiveMode::EPOLL);
 
-    void run();   // main event loop
+    ~BasicFeedHandler();
+
+    // Default constructed; set it up through handler() before run(), after
+    // that it belongs to the network thread
+    Handler& handler() { return handler_; }
+    const Handler& handler() const { return handler_; }
+
+    // Subscription changes, callable from any thread. The network thread
+    // sends them in call order and replays the resulting set on every
+    // reconnect; ids >= MAX_SYMBOLS are ignored. Nothing is subscribed
+    // until the first call.
+    void subscribe(const std::vector<uint16_t>& symbols);
+    void unsubscribe(const std::vector<uint16_t>& symbols);
+    void replace_subscriptions(const std::vector<uint16_t>& symbols);
+
+    ReceiveMode receive_mode() const { return receive_mode_; }
+
+    // Takes market data from the simulator's UDP multicast group instead of
+    // the TCP stream; TCP stays up for subscriptions and recovery.
+    // iface is the local address to join on (127.0.0.1 for loopback).
+    // Must be called before run().
+    void enable_multicast(const std::string& group, uint16_t port, const std::string& iface);
+
+    // Records every received TCP read / datagram, as it came off the wire
+    // and with its receive time, into journal files under config.directory.
+    // Throws std::runtime_error if the first file cannot be created.
+    // Must be called before run().
+    void enable_capture(const JournalConfig& config);
+    const TickJournal* journal() const { return journal_.get(); }
+
+    void run();   // main event loop, reconnects on its own
+
+    // True if the cached data for symbol predates the current connection
+    // (or the connection is down): still readable, but not live.
+    bool is_stale(uint16_t symbol) const;
 
     bool get_latest(uint16_t symbol, MarketMessage& out) const;
+
+    // Lock-free copy of the symbol's book; false if nothing has arrived yet
+    bool get_book(uint16_t symbol, OrderBook& out) const;
+
+    // Every message applied to the cache, in order, for consumers that need
+    // the whole stream rather than the latest value: stream().subscribe()
+    // from any thread. The network thread never waits for them.
+    BroadcastRing& stream() { return stream_; }
+    const BroadcastRing& stream() const { return stream_; }
     // std::mutex mtx_;
 private:
+    // Offline instance for bench/feed_handler_bench.cpp and the tests: no
+    // socket, drives on_message() and the recovery merge directly
+    friend struct FeedHandlerBench;
+    friend struct FeedHandlerTest;
+    BasicFeedHandler() = default;
+
     // network
+    static constexpr uint64_t RECONNECT_BASE_MS = 100;
+    static constexpr uint64_t RECONNECT_MAX_MS  = 5000;
+    static constexpr uint64_t CONNECT_TIMEOUT_MS = 3000;   // CONNECTING longer than this: give up and back off
+    static constexpr int BUSY_POLL_US = 50;                 // SO_BUSY_POLL budget per recv
+    static constexpr uint32_t BUSY_POLL_EPOLL_EVERY = 1024; // spins between epoll checks of the other fds
+
     MarketDataSocket socket_;
     int epoll_fd_{-1};
+    std::string host_;
+    uint16_t port_{0};
+    uint8_t wire_version_{PROTOCOL_VERSION_2};
+    bool batch_frames_{true};
+    ReceiveMode receive_mode_{ReceiveMode::EPOLL};
+    UringReceiver uring_;   // IO_URING mode, one ring per connection
+    uint16_t recovery_port_{0};
+    RecoveryChannel recovery_;
+
+    std::atomic<ConnectionState> conn_state_{ConnectionState::CONNECTING};
+    uint32_t epoch_{0};                     // network thread only
+    std::atomic<uint32_t> live_epoch_{0};   // epoch_ while CONNECTED, else 0
+    uint32_t backoff_attempt_{0};
+    uint64_t retry_at_ns_{0};
+    uint64_t connect_deadline_ns_{0};
+    uint64_t jitter_state_{0};
+    std::atomic<uint64_t> reconnects_{0};
 
     // parsing
     Parser parser_;
     StreamBuffer stream_buffer_;
 
+    // multicast receive: one recvmmsg() fills up to MCAST_BATCH datagrams
+    static constexpr size_t MCAST_BATCH  = 32;
+    static constexpr size_t MCAST_STRIDE = 2048;   // > largest datagram the publisher sends
+    bool multicast_{false};
+    std::string mcast_group_;
+    uint16_t mcast_port_{0};
+    std::string mcast_iface_;
+    Parser mcast_parser_;                    // datagrams are self-contained, no stream state
+    std::vector<uint8_t> mcast_buffers_;     // MCAST_BATCH * MCAST_STRIDE
+    uint64_t expected_packet_{0};            // next packet sequence, 0 = none yet
+    std::atomic<uint64_t> mcast_packets_{0};
+    std::atomic<uint64_t> mcast_packet_gaps_{0};
+
+    std::unique_ptr<TickJournal> journal_;   // null unless capturing
+
     // state
     // std::unordered_map<uint16_t, SymbolSnapshot> symbols_;
     static constexpr size_t MAX_SYMBOLS = 1024;
     std::array<SymbolState, MAX_SYMBOLS> symbols_;
+    std::array<uint64_t, MAX_SYMBOLS> expected_seq_{};   // next live sequence per symbol, 0 = none yet
+    std::bitset<MAX_SYMBOLS> subscribed_;                // network thread only; filters both feeds
+
+    // subscribe() & co. -> network thread
+    struct SubscriptionChange {
+        uint8_t opcode;   // OPCODE_SUBSCRIBE_ADD / OPCODE_UNSUBSCRIBE / OPCODE_SUBSCRIBE_REPLACE
+        std::vector<uint16_t> symbols;
+    };
+    std::mutex subscription_mutex_;
+    std::vector<SubscriptionChange> pending_changes_;   // guarded by subscription_mutex_
+    int wake_fd_{-1};                                   // eventfd, written after queueing a change
+    std::atomic<size_t> subscribed_count_{0};
+
+    // Gap recovery, network thread only. While a symbol has ranges out, its
+    // live ticks are held back and merged in sequence order with the
+    // replay, so the cache, the book, stream() and the handler see one
+    // ordered stream.
+    static constexpr size_t MAX_HELD = 4096;   // per symbol; past it, stop waiting for the replay
+    std::array<uint32_t, MAX_SYMBOLS> pending_ranges_{};   // requested, not yet ended
+    std::array<uint64_t, MAX_SYMBOLS> replay_next_{};      // next sequence the merge may apply
+    std::array<std::deque<MarketMessage>, MAX_SYMBOLS> held_;
 
     // stats
     std::atomic<uint64_t> messages_{0};
     std::atomic<uint64_t> seq_gaps_{0};
+    std::atomic<uint64_t> duplicates_{0};
+    std::atomic<uint64_t> withheld_{0};
+    std::atomic<uint64_t> snapshots_{0};
+    LatencyHistogram latency_;
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> batched_messages_{0};
+    LatencyHistogram batch_latency_;
+
+    BroadcastRing stream_;   // on_message() -> strategy threads
+
+    Handler handler_;
+
+    static uint64_t steady_now_ns() {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
 
     void on_message(const MarketMessage& msg);
     void handle_socket_read();
+    void handle_uring_read();
+    void process_stream_buffer();
+    void handle_multicast_read();
+    void on_datagram(const uint8_t* data, size_t len);
+    bool check_sequence(const MarketMessage& msg);
+    bool hold_if_recovering(const MarketMessage& msg);
+    void apply_recovered(const MarketMessage& msg);
+    void on_replay(const MarketMessage& msg);
+    void on_range_end(uint16_t symbol);
+    void release_held(uint16_t symbol);
+    void queue_subscription_change(uint8_t opcode, const std::vector<uint16_t>& symbols);
+    void apply_subscription_changes();
+
+    // reconnect state machine
+    bool start_connect();
+    void on_connect_ready();
+    void on_disconnect(const char* reason);
+    void schedule_reconnect();
+    int  epoll_timeout_ms() const;
     
     bool get_latest(uint16_t symbol, MarketMessage& out) ;
 };
 
+extern template class BasicFeedHandler<NullHandler>;
+using FeedHandler = BasicFeedHandler<>;
+
 #endif
@@ -0,0 +1,879 @@
+#ifndef FEED_HANDLER_IMPL_H
+#define FEED_HANDLER_IMPL_H
+
+#include "feed_handler.hpp"
+
+#include "market_data_socket.hpp"
+#include "parser.hpp"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <array>
+// void FeedHandler::on_message(const MarketMessage& msg) {
+//     std::lock_guard<std::mutex> lock(mtx_);
+//     auto& entry = symbols_[msg.symbol_id];
+//     entry.last_msg = msg;
+//     entry.has_data = true;
+// }
+template <typename Handler>
+BasicFeedHandler<Handler>::BasicFeedHandler(const std::string& host, uint16_t port,
+                                            uint16_t recovery_port, uint8_t wire_version, bool batch_frames,
+                                            ReceiveMode receive_mode)
+    : host_(host),
+      port_(port),
+      wire_version_(wire_version),
+      batch_frames_(batch_frames),
+      receive_mode_(receive_mode),
+      recovery_port_(recovery_port),
+      jitter_state_(steady_now_ns() | 1),
+      stream_buffer_(256 * 1024)
+{
+    if (receive_mode_ == ReceiveMode::IO_URING && !UringReceiver::supported()) {
+        std::cerr << "[FeedHandler] io_uring unavailable, using epoll\n";
+        receive_mode_ = ReceiveMode::EPOLL;
+    }
+
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        throw std::runtime_error(std::string("eventfd failed: ") + strerror(errno));
+    }
+
+    // A refused or failed first connect backs off and retries like any other
+    if (!start_connect()) {
+        schedule_reconnect();
+    }
+}
+
+template <typename Handler>
+BasicFeedHandler<Handler>::~BasicFeedHandler() {
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+    }
+}
+
+template <typename Handler>
+void BasicFeedHandler<Handler>::subscribe(const std::vector<uint16_t>& symbols) {
+    queue_subscription_change(OPCODE_SUBSCRIBE_ADD, symbols);
+}
+
+template <typename Handler>
+void BasicFeedHandler<Handler>::unsubscribe(const std::vector<uint16_t>& symbols) {
+    queue_subscription_change(OPCODE_UNSUBSCRIBE, symbols);
+}
+
+template <typename Handler>
+void BasicFeedHandler<Handler>::replace_subscriptions(const std::vector<uint16_t>& symbols) {
+    queue_subscription_change(OPCODE_SUBSCRIBE_REPLACE, symbols);
+}
+
+template <typename Handler>
+void BasicFeedHandler<Handler>::queue_subscription_change(uint8_t opcode, const std::vector<uint16_t>& symbols) {
+    SubscriptionChange change{opcode, {}};
+    change.symbols.reserve(symbols.size());
+    for (uint16_t sym : symbols) {
+        if (sym < MAX_SYMBOLS) {
+            change.symbols.push_back(sym);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(subscription_mutex_);
+        pending_changes_.push_back(std::move(change));
+    }
+    const uint64_t one = 1;
+    if (wake_fd_ >= 0 && write(wake_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        perror("eventfd write");
+    }
+}
+
+// Network thread. Folds queued changes into subscribed_ and, while
+// connected, forwards each one to the server; otherwise the next
+// subscription frame carries the result. A symbol that comes back has
+// moved on meanwhile, so its sequence tracking starts over; one that goes
+// leaves no recovery state behind.
+template <typename Handler>
+void BasicFeedHandler<Handler>::apply_subscription_changes() {
+    std::vector<SubscriptionChange> changes;
+    {
+        std::lock_guard<std::mutex> lock(subscription_mutex_);
+        changes.swap(pending_changes_);
+    }
+
+    for (const SubscriptionChange& change : changes) {
+        const std::bitset<MAX_SYMBOLS> before = subscribed_;
+        if (change.opcode == OPCODE_SUBSCRIBE_REPLACE) {
+            subscribed_.reset();
+        }
+        for (uint16_t sym : change.symbols) {
+            subscribed_.set(sym, change.opcode != OPCODE_UNSUBSCRIBE);
+        }
+        const std::bitset<MAX_SYMBOLS> added   = subscribed_ & ~before;
+        const std::bitset<MAX_SYMBOLS> removed = before & ~subscribed_;
+        for (size_t sym = 0; sym < MAX_SYMBOLS; ++sym) {
+            if (added.test(sym)) {
+                expected_seq_[sym] = 0;
+            }
+            // Its held ticks are dropped and its replay ignored from here on
+            if (removed.test(sym)) {
+                held_[sym].clear();
+                pending_ranges_[sym] = 0;
+            }
+        }
+
+        if (conn_state_.load(std::memory_order_relaxed) == ConnectionState::CONNECTED &&
+            !socket_.send_subscription_change(change.opcode, change.symbols)) {
+            on_disconnect("Failed to send subscription change");
+        }
+    }
+    subscribed_count_.store(subscribed_.count(), std::memory_order_relaxed);
+}
+
+
+
+// void FeedHandler::on_message(const MarketMessage& msg) {
+//     auto& state = symbols_[msg.symbol_id];
+
+//     uint64_t v = state.version.load(std::memory_order_relaxed);
+//     state.version.store(v + 1, std::memory_order_release); // mark write start (odd)
+
+//     state.data = msg;
+
+//     state.version.store(v + 2, std::memory_order_release); // mark write end (even)
+// }
+
+template <typename Handler>
+void BasicFeedHandler<Handler>::on_message(const MarketMessage& msg) {
+    if (msg.symbol_id >= MAX_SYMBOLS) {
+        // Drop malformed / unexpected symbol
+        return;
+    }
+
+    // Resolved per Handler at compile time; absent hooks cost nothing
+    if constexpr (handler_traits::has_on_quote<Handler>::value) {
+        if (msg.type == MessageType::QUOTE) handler_.on_quote(msg);
+    }
+    if constexpr (handler_traits::has_on_trade<Handler>::value) {
+        if (msg.type == MessageType::TRADE) handler_.on_trade(msg);
+    }
+    if constexpr (handler_traits::has_on_depth<Handler>::value) {
+        if (msg.type == MessageType::DEPTH) handler_.on_depth(msg);
+    }
+    if constexpr (handler_traits::has_on_snapshot<Handler>::value) {
+        if (msg.type == MessageType::SNAPSHOT) handler_.on_snapshot(msg);
+    }
+    if constexpr (!handler_traits::uses_cache<Handler>::value) {
+        return;
+    }
+
+    auto& state = symbols_[msg.symbol_id];
+
+    uint64_t v = state.version.load(std::memory_order_relaxed);
+    state.version.store(v + 1, std::memory_order_release); // write begin (odd)
+
+    state.epoch.store(epoch_, std::memory_order_relaxed);
+    if (msg.type != MessageType::DEPTH) {
+        state.data = msg;
+    }
+    state.book.apply(msg);
+    // std::cout << "RX symbol=" << msg.symbol_id << "\n";
+
+    state.version.store(v + 2, std::memory_order_release); // write end (even)
+
+    stream_.publish(msg);
+}
+
+
+// bool FeedHandler::get_latest(uint16_t symbol, MarketMessage& out) {
+//     std::lock_guard<std::mutex> lock(mtx_);
+//     auto it = symbols_.find(symbol);
+//     if (it == symbols_.end() || !it->second.has_data)
+//         return false;
+
+//     out = it->second.last_msg;
+//     return true;
+// }
+
+// bool FeedHandler::get_latest(uint16_t symbol, MarketMessage& out) const {
+//     const auto& state = symbols_[symbol];
+
+//     while (true) {
+//         uint64_t v1 = state.version.load(std::memory_order_acquire);
+//         if (v1 & 1) continue; // writer in progress
+
+//         MarketMessage tmp = state.data;
+
+//         uint64_t v2 = state.version.load(std::memory_order_acquire);
+//         if (v1 == v2) {
+//             out = tmp;
+//             return v2 != 0;
+//         }
+//     }
+// }
+
+template <typename Handler>
+bool BasicFeedHandler<Handler>::get_latest(uint16_t symbol, MarketMessage& out) const {
+    if (symbol >= MAX_SYMBOLS) {
+        return false;
+    }
+
+    const auto& state = symbols_[symbol];
+
+    while (true) {
+        uint64_t v1 = state.version.load(std::memory_order_acquire);
+        if (v1 & 1) continue;
+
+        MarketMessage tmp = state.data;
+
+        uint64_t v2 = state.version.load(std::memory_order_acquire);
+        if (v1 == v2) {
+            out = tmp;
+            return v2 != 0;
+        }
+    }
+}
+
+template <typename Handler>
+bool BasicFeedHandler<Handler>::get_book(uint16_t symbol, OrderBook& out) const {
+    if (symbol >= MAX_SYMBOLS) {
+        return false;
+    }
+
+    const auto& state = symbols_[symbol];
+
+    while (true) {
+        uint64_t v1 = state.version.load(std::memory_order_acquire);
+        if (v1 & 1) continue;
+
+        out = state.book;
+
+        uint64_t v2 = state.version.load(std::memory_order_acquire);
+        if (v1 == v2) {
+            return v2 != 0;
+        }
+    }
+}
+
+// Sequences are per symbol, so a jump means messages of that symbol were
+// lost; the missing range goes to the retransmit channel. A GAP_FILL from a
+// conflating server moves the expected sequence past what it withheld;
+// it carries no data, so false tells the caller not to apply it. A SNAPSHOT
+// anchors the symbol: the live stream continues at its sequence + 1.
+// Ticks of a symbol with a range out are held, and false is returned for
+// them too: they are applied later, in order, by the recovery merge.
+template <typename Handler>
+bool BasicFeedHandler<Handler>::check_sequence(const MarketMessage& msg) {
+    if (msg.symbol_id >= MAX_SYMBOLS) {
+        return true;
+    }
+    uint64_t& expected = expected_seq_[msg.symbol_id];
+    if (msg.type == MessageType::GAP_FILL) {
+        if (msg.sequence >= expected) {
+            withheld_.fetch_add(expected != 0 ? msg.sequence + 1 - expected : 0, std::memory_order_relaxed);
+            expected = msg.sequence + 1;
+        }
+        return false;
+    }
+    if (msg.type == MessageType::SNAPSHOT) {
+        // Multicast ticks can overtake the snapshot on TCP; keep the newer
+        if (expected != 0 && msg.sequence + 1 < expected) {
+            return false;
+        }
+        expected = msg.sequence + 1;
+        snapshots_.fetch_add(1, std::memory_order_relaxed);
+        return hold_if_recovering(msg);
+    }
+    // Older than what was applied: a duplicate or a tick overtaken by a
+    // later one. Applying it would roll the cache and the book back.
+    if (expected != 0 && msg.sequence < expected) {
+        duplicates_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (expected != 0 && msg.sequence > expected) {
+        const uint64_t from = expected;
+        seq_gaps_.fetch_add(msg.sequence - from, std::memory_order_relaxed);
+        expected = msg.sequence + 1;
+        if constexpr (handler_traits::has_on_gap<Handler>::value) {
+            handler_.on_gap(msg.symbol_id, from, msg.sequence - 1);
+        }
+        // Held before the request: without a recovery port the range ends
+        // (and the hold is released) inside request()
+        if (pending_ranges_[msg.symbol_id]++ == 0) {
+            replay_next_[msg.symbol_id] = from;
+        }
+        held_[msg.symbol_id].push_back(msg);
+        recovery_.request(msg.symbol_id, from, msg.sequence - 1);
+        return false;
+    }
+    expected = msg.sequence + 1;
+    return hold_if_recovering(msg);
+}
+
+// True: apply now. A symbol that has held too much stops waiting: what it
+// holds is applied and the rest of its replay is ignored.
+template <typename Handler>
+bool BasicFeedHandler<Handler>::hold_if_recovering(const MarketMessage& msg) {
+    if (pending_ranges_[msg.symbol_id] == 0) {
+        return true;
+    }
+    std::deque<MarketMessage>& held = held_[msg.symbol_id];
+    if (held.size() >= MAX_HELD) {
+        release_held(msg.symbol_id);
+        return true;
+    }
+    held.push_back(msg);
+    return false;
+}
+
+template <typename Handler>
+void BasicFeedHandler<Handler>::apply_recovered(const MarketMessage& msg) {
+    replay_next_[msg.symbol_id] = msg.sequence + 1;
+    on_message(msg);
+    messages_.fetch_add(1, std::memory_order_relaxed);
+}
+
+// A replayed tick: held ticks older than it go first, then it, unless it
+// is a duplicate of something already applied
+template <typename Handler>
+void BasicFeedHandler<Handler>::on_replay(const MarketMessage& msg) {
+    if (msg.symbol_id >= MAX_SYMBOLS || pending_ranges_[msg.symbol_id] == 0) {
+        return;   // gave up on it, or the feed reconnected
+    }
+    std::deque<MarketMessage>& held = held_[msg.symbol_id];
+    while (!held.empty() && held.front().sequence < msg.sequence) {
+        apply_recovered(held.front());
+        held.pop_front();
+    }
+    if (msg.sequence >= replay_next_[msg.symbol_id] &&
+        (held.empty() || msg.sequence < held.front().sequence)) {
+        apply_recovered(msg);
+    }
+}
+
+template <typename Handler>
+void BasicFeedHandler<Handler>::on_range_end(uint16_t symbol) {
+    if (symbol >= MAX_SYMBOLS || pending_ranges_[symbol] == 0) {
+        return;
+    }
+    if (--pending_ranges_[symbol] == 0) {
+        release_held(symbol);
+    }
+}
+
+// Whatever the replay did not fill stays lost; the held ticks go out in order
+template <typename Handler>
+void BasicFeedHandler<Handler>::release_held(uint16_t symbol) {
+    pending_ranges_[symbol] = 0;
+    std::deque<MarketMessage>& held = held_[symbol];
+    for (const MarketMessage& msg : held) {
+        apply_recovered(msg);
+    }
+    held.clear();
+    stream_.wake_waiters();
+}
+
+template <typename Handler>
+bool BasicFeedHandler<Handler>::is_stale(uint16_t symbol) const {
+    if (symbol >= MAX_SYMBOLS) {
+        return true;
+    }
+    const uint32_t live = live_epoch_.load(std::memory_order_relaxed);
+    return live == 0 || symbols_[symbol].epoch.load(std::memory_order_relaxed) != live;
+}
+
+template <typename Handler>
+void BasicFeedHandler<Handler>::enable_multicast(const std::string& group, uint16_t port, const std::string& iface) {
+    multicast_    = true;
+    mcast_group_  = group;
+    mcast_port_   = port;
+    mcast_iface_  = iface;
+    mcast_buffers_.resize(MCAST_BATCH * MCAST_STRIDE);
+}
+
+template <typename Handler>
+void BasicFeedHandler<Handler>::enable_capture(const JournalConfig& config) {
+    journal_.reset(new TickJournal(config));
+}
+
+template <typename Handler>
+void BasicFeedHandler<Handler>::run() {
+    epoll_fd_ = epoll_create1(0);
+    if (epoll_fd_ < 0) {
+        perror("epoll_create1");
+        return;
+    }
+
+    recovery_.configure(host_, recovery_port_, epoll_fd_,
+                        [this](const MarketMessage& msg) { on_replay(msg); },
+                        [this](uint16_t symbol) { on_range_end(symbol); });
+
+    // Joined once: the group outlives any TCP reconnect
+    if (multicast_) {
+        bool joined = socket_.join_multicast(mcast_group_.c_str(), mcast_port_, mcast_iface_.c_str());
+        if (joined) {
+            epoll_event mev{};
+            mev.events = EPOLLIN | EPOLLET;
+            mev.data.fd = socket_.multicast_fd();
+            joined = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket_.multicast_fd(), &mev) == 0;
+        }
+        if (!joined) {
+            perror("multicast join");
+            std::cerr << "[FeedHandler] Multicast unavailable, using the TCP feed\n";
+            socket_.leave_multicast();
+            multicast_ = false;
+        }
+    }
+
+    // The constructor started the first connect, unless it is backing off
+    // already; watch it complete
+    if (conn_state_.load(std::memory_order_relaxed) == ConnectionState::CONNECTING) {
+        epoll_event ev{};
+        ev.events = EPOLLOUT | EPOLLET;
+        ev.data.fd = socket_.get_fd();
+
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket_.get_fd(), &ev) < 0) {
+            perror("epoll_ctl");
+            return;
+        }
+    }
+
+    epoll_event wev{};
+    wev.events = EPOLLIN | EPOLLET;
+    wev.data.fd = wake_fd_;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &wev) < 0) {
+        perror("epoll_ctl");
+        return;
+    }
+
+    epoll_event events[8];
+
+    std::cout << "[FeedHandler] Running event loop\n";
+
+    uint32_t spins = 0;
+    while (true) {
+        // Busy poll: pull from the socket directly; the other fds are only
+        // looked at every BUSY_POLL_EPOLL_EVERY spins, without blocking
+        const bool spinning = receive_mode_ == ReceiveMode::BUSY_POLL &&
+                              conn_state_.load(std::memory_order_relaxed) == ConnectionState::CONNECTED;
+        if (spinning) {
+            try {
+                handle_socket_read();
+            } catch (const std::exception& ex) {
+                on_disconnect(ex.what());
+            }
+            if (++spins % BUSY_POLL_EPOLL_EVERY != 0) {
+                continue;
+            }
+        }
+
+        int n = epoll_wait(epoll_fd_, events, 8, spinning ? 0 : epoll_timeout_ms());
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.fd == wake_fd_) {
+                uint64_t ignored;
+                while (read(wake_fd_, &ignored, sizeof(ignored)) > 0) {
+                }
+                apply_subscription_changes();
+                continue;
+            }
+            if (multicast_ && events[i].data.fd == socket_.multicast_fd()) {
+                handle_multicast_read();
+                continue;
+            }
+            if (events[i].data.fd == recovery_.fd()) {
+                recovery_.on_event(events[i].events);
+                stream_.wake_waiters();   // replayed and released held ticks
+                continue;
+            }
+            if (events[i].data.fd == uring_.fd()) {
+                try {
+                    handle_uring_read();
+                } catch (const std::exception& ex) {
+                    on_disconnect(ex.what());
+                }
+                continue;
+            }
+
+            const ConnectionState state = conn_state_.load(std::memory_order_relaxed);
+
+            if (state == ConnectionState::CONNECTING) {
+                on_connect_ready();
+                continue;
+            }
+            if (state != ConnectionState::CONNECTED) {
+                continue;
+            }
+
+            if (events[i].events & EPOLLIN) {
+                try {
+                    handle_socket_read();
+                } catch (const std::exception& ex) {
+                    on_disconnect(ex.what());
+                    continue;
+                }
+            }
+            if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                on_disconnect("Socket error");
+            }
+        }
+
+        const ConnectionState state = conn_state_.load(std::memory_order_relaxed);
+        if (state == ConnectionState::BACKOFF && steady_now_ns() >= retry_at_ns_) {
+            if (!start_connect()) {
+                schedule_reconnect();
+            }
+        } else if (state == ConnectionState::CONNECTING && steady_now_ns() >= connect_deadline_ns_) {
+            // No SYN-ACK and no error (a blackholed route): the kernel would
+            // keep retrying the SYN for minutes
+            on_disconnect("Connect timed out");
+        }
+    }
+    close(epoll_fd_);
+}
+
+// Opens a new socket with a non-blocking connect. Called from the
+// constructor (before epoll exists) and from run() on every retry.
+template <typename Handler>
+bool BasicFeedHandler<Handler>::start_connect() {
+    if (!socket_.connect_to(host_.c_str(), port_)) {
+        return false;
+    }
+    conn_state_.store(ConnectionState::CONNECTING, std::memory_order_relaxed);
+    connect_deadline_ns_ = steady_now_ns() + CONNECT_TIMEOUT_MS * 1'000'000ULL;
+
+    if (epoll_fd_ >= 0) {
+        epoll_event ev{};
+        ev.events = EPOLLOUT | EPOLLET;
+        ev.data.fd = socket_.get_fd();
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket_.get_fd(), &ev) < 0) {
+            perror("epoll_ctl");
+            socket_.close();
+            return false;
+        }
+    }
+    return true;
+}
+
+// EPOLLOUT (or an error) on a connecting socket: the handshake is over
+template <typename Handler>
+void BasicFeedHandler<Handler>::on_connect_ready() {
+    const int err = socket_.finish_connect();
+    if (err != 0) {
+        on_disconnect(strerror(err));
+        return;
+    }
+
+    // io_uring: the ring reports data, the socket only errors and hangups
+    epoll_event ev{};
+    ev.events = receive_mode_ == ReceiveMode::IO_URING ? 0 : (EPOLLIN | EPOLLET);
+    ev.data.fd = socket_.get_fd();
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, socket_.get_fd(), &ev);
+
+    if (receive_mode_ == ReceiveMode::IO_URING) {
+        bool armed = uring_.open(socket_.get_fd());
+        if (armed) {
+            epoll_event rev{};
+            rev.events = EPOLLIN;
+            rev.data.fd = uring_.fd();
+            armed = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, uring_.fd(), &rev) == 0;
+        }
+        if (!armed) {
+            // supported() passed but the ring did not come up: carry on with
+            // epoll rather than reconnecting into the same failure
+            perror("[FeedHandler] io_uring setup failed, using epoll");
+            uring_.close();
+            receive_mode_ = ReceiveMode::EPOLL;
+            ev.events = EPOLLIN | EPOLLET;
+            epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, socket_.get_fd(), &ev);
+        }
+    } else if (receive_mode_ == ReceiveMode::BUSY_POLL &&
+               !socket_.enable_busy_poll(BUSY_POLL_US)) {
+        // Without it the spin still skips epoll, just not the driver poll
+        perror("SO_BUSY_POLL");
+    }
+
+    // Not CONNECTED yet: changes queued so far only update the set
+    apply_subscription_changes();
+    std::vector<uint16_t> subscriptions;
+    for (uint16_t sym = 0; sym < MAX_SYMBOLS; ++sym) {
+        if (subscribed_.test(sym)) {
+            subscriptions.push_back(sym);
+        }
+    }
+
+    const uint8_t flags = SUBSCRIBE_FLAG_SNAPSHOT |
+                          (batch_frames_ ? SUBSCRIBE_FLAG_BATCH : 0) |
+                          (multicast_ ? SUBSCRIBE_FLAG_MULTICAST : 0);
+    if (!socket_.send_subscription(subscriptions, wire_version_, flags)) {
+        on_disconnect("Failed to send subscription");
+        return;
+    }
+
+    // New epoch: everything cached so far becomes stale until refreshed.
+    // Sequences restart from whatever the server sends first.
+    ++epoch_;
+    expected_seq_.fill(0);
+    expected_packet_ = 0;   // the publisher may have restarted too
+    live_epoch_.store(epoch_, std::memory_order_relaxed);
+    backoff_attempt_ = 0;
+    conn_state_.store(ConnectionState::CONNECTED, std::memory_order_relaxed);
+
+    std::cout << "[FeedHandler] Connected, subscription sent ("
+              << subscriptions.size() << " symbols)\n";
+
+    // Data may have arrived with the connect under edge triggering; the
+    // armed io_uring receive picks it up by itself
+    if (receive_mode_ == ReceiveMode::IO_URING) {
+        return;
+    }
+    try {
+        handle_socket_read();
+    } catch (const std::exception& ex) {
+        on_disconnect(ex.what());
+    }
+}
+
+// Drops the socket and any partial message; the symbol cache is kept and
+// reads as stale until the next connection refreshes it.
+template <typename Handler>
+void BasicFeedHandler<Handler>::on_disconnect(const char* reason) {
+    std::cerr << "[FeedHandler] " << reason << ", reconnecting\n";
+
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, socket_.get_fd(), nullptr);
+    if (uring_.fd() >= 0) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, uring_.fd(), nullptr);
+        uring_.close();
+    }
+    socket_.close();
+    stream_buffer_.consume(stream_buffer_.data_size());
+    parser_.reset();
+
+    // Held ticks and open ranges belong to the dead connection; its replays
+    // would land behind the next one's anchors. Cleared first, so the ranges
+    // abandon() ends release nothing.
+    for (std::deque<MarketMessage>& held : held_) {
+        held.clear();
+    }
+    pending_ranges_.fill(0);
+    recovery_.abandon();
+
+    live_epoch_.store(0, std::memory_order_relaxed);
+    reconnects_.fetch_add(1, std::memory_order_relaxed);
+    schedule_reconnect();
+}
+
+// Exponential backoff with equal jitter: the delay for attempt k is drawn
+// from [d/2, d] with d = min(RECONNECT_MAX_MS, RECONNECT_BASE_MS * 2^k), so
+// a fleet of handlers does not reconnect in lockstep after a restart.
+template <typename Handler>
+void BasicFeedHandler<Handler>::schedule_reconnect() {
+    const uint32_t shift = backoff_attempt_ < 16 ? backoff_attempt_ : 16;
+    const uint64_t cap_ms = std::min<uint64_t>(RECONNECT_MAX_MS, RECONNECT_BASE_MS << shift);
+    ++backoff_attempt_;
+
+    // xorshift64
+    jitter_state_ ^= jitter_state_ << 13;
+    jitter_state_ ^= jitter_state_ >> 7;
+    jitter_state_ ^= jitter_state_ << 17;
+    const uint64_t delay_ms = cap_ms / 2 + jitter_state_ % (cap_ms / 2 + 1);
+
+    retry_at_ns_ = steady_now_ns() + delay_ms * 1'000'000ULL;
+    conn_state_.store(ConnectionState::BACKOFF, std::memory_order_relaxed);
+}
+
+template <typename Handler>
+int BasicFeedHandler<Handler>::epoll_timeout_ms() const {
+    // Wake for the next retry, or to give up on a connect that hangs
+    const ConnectionState state = conn_state_.load(std::memory_order_relaxed);
+    uint64_t deadline;
+    if (state == ConnectionState::BACKOFF) {
+        deadline = retry_at_ns_;
+    } else if (state == ConnectionState::CONNECTING) {
+        deadline = connect_deadline_ns_;
+    } else {
+        return -1;
+    }
+    const uint64_t now = steady_now_ns();
+    if (now >= deadline) {
+        return 0;
+    }
+    return static_cast<int>((deadline - now + 999'999) / 1'000'000);
+}
+
+template <typename Handler>
+void BasicFeedHandler<Handler>::handle_socket_read() {
+    while (true) {
+        // Receive straight into the ring; the mirror mapping keeps the free
+        // region contiguous even when it straddles the wrap point.
+        uint8_t* dst = stream_buffer_.write_ptr();
+        ssize_t bytes = socket_.recv_data(dst, stream_buffer_.free_space());
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            throw std::runtime_error(std::string("recv failed: ") + strerror(errno));
+        }
+        if (bytes == 0) {
+            throw std::runtime_error("Connection closed by peer");
+        }
+
+        stream_buffer_.commit(static_cast<size_t>(bytes));
+        if (journal_) {
+            journal_->append(JournalSource::TCP, dst, static_cast<size_t>(bytes), steady_now_ns());
+        }
+        process_stream_buffer();
+    }
+}
+
+// io_uring completions: each one is a filled provided buffer
+template <typename Handler>
+void BasicFeedHandler<Handler>::handle_uring_read() {
+    const UringReceiver::Status status = uring_.drain([&](const uint8_t* data, size_t len) {
+        if (!stream_buffer_.append(data, len)) {
+            throw std::runtime_error("Receive buffer overflow");
+        }
+        if (journal_) {
+            journal_->append(JournalSource::TCP, data, len, steady_now_ns());
+        }
+        process_stream_buffer();
+    });
+    if (status == UringReceiver::Status::CLOSED) {
+        throw std::runtime_error("Connection closed by peer");
+    }
+    if (status == UringReceiver::Status::FAILED) {
+        throw std::runtime_error(std::string("io_uring recv failed: ") + strerror(errno));
+    }
+}
+
+// Decodes every complete message in one pass; a trailing partial message
+// stays in the buffer until the next read completes it.
+template <typename Handler>
+void BasicFeedHandler<Handler>::process_stream_buffer() {
+    size_t count = 0;
+    const size_t consumed = parser_.parse_batch(
+        stream_buffer_.data_ptr(),
+        stream_buffer_.data_size(),
+        [&](const MarketMessage& msg) {
+            // In flight from before an unsubscribe
+            if (msg.symbol_id >= MAX_SYMBOLS || !subscribed_.test(msg.symbol_id)) {
+                return;
+            }
+            if (!check_sequence(msg)) {
+                return;
+            }
+            on_message(msg);
+            ++count;
+
+            // A snapshot is stamped with its quote's time, not when it was sent
+            if (msg.type == MessageType::SNAPSHOT) {
+                return;
+            }
+            // Server stamps with steady_clock too; on one host the clocks agree
+            const uint64_t now = steady_now_ns();
+            latency_.record(now > msg.timestamp_ns ? now - msg.timestamp_ns : 0);
+        },
+        [&](const BatchInfo& batch) {
+            batches_.fetch_add(1, std::memory_order_relaxed);
+            batched_messages_.fetch_add(batch.count, std::memory_order_relaxed);
+
+            const uint64_t now = steady_now_ns();
+            batch_latency_.record(now > batch.send_timestamp_ns ? now - batch.send_timestamp_ns : 0);
+        });
+
+    messages_.fetch_add(count, std::memory_order_relaxed);
+    stream_buffer_.consume(consumed);
+    stream_.wake_waiters();
+
+    if (parser_.malformed()) {
+        throw std::runtime_error("Malformed frame");
+    }
+}
+
+
+// Drains the group socket, MCAST_BATCH datagrams per recvmmsg()
+template <typename Handler>
+void BasicFeedHandler<Handler>::handle_multicast_read() {
+    size_t sizes[MCAST_BATCH];
+    while (true) {
+        const int n = socket_.recv_datagrams(mcast_buffers_.data(), MCAST_STRIDE, sizes, MCAST_BATCH);
+        if (journal_) {
+            const uint64_t now = steady_now_ns();
+            for (int i = 0; i < n; ++i) {
+                journal_->append(JournalSource::MULTICAST, mcast_buffers_.data() + i * MCAST_STRIDE, sizes[i], now);
+            }
+        }
+        for (int i = 0; i < n; ++i) {
+            on_datagram(mcast_buffers_.data() + i * MCAST_STRIDE, sizes[i]);
+        }
+        if (n < static_cast<int>(MCAST_BATCH)) {
+            return;
+        }
+    }
+}
+
+// One datagram: packet header, then whole v2 frames. A missing packet
+// sequence is counted here; the ticks it carried show up as per-symbol
+// gaps and are requested from the retransmit channel like on TCP.
+template <typename Handler>
+void BasicFeedHandler<Handler>::on_datagram(const uint8_t* data, size_t len) {
+    if (len < sizeof(v2::PacketHeader)) {
+        return;
+    }
+    v2::PacketHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    const uint64_t seq = le64toh(header.packet_sequence);
+
+    // Late duplicate or reordered datagram: its ticks are older than the
+    // cache. Sequence 1 again means the publisher restarted.
+    if (expected_packet_ != 0 && seq < expected_packet_ && seq != 1) {
+        return;
+    }
+    if (expected_packet_ != 0 && seq > expected_packet_) {
+        mcast_packet_gaps_.fetch_add(seq - expected_packet_, std::memory_order_relaxed);
+    }
+    expected_packet_ = seq + 1;
+    mcast_packets_.fetch_add(1, std::memory_order_relaxed);
+
+    size_t count = 0;
+    const uint64_t now = steady_now_ns();
+    mcast_parser_.parse_batch(
+        data + sizeof(header), len - sizeof(header),
+        [&](const MarketMessage& msg) {
+            if (msg.symbol_id >= MAX_SYMBOLS || !subscribed_.test(msg.symbol_id)) {
+                return;
+            }
+            if (!check_sequence(msg)) {
+                return;
+            }
+            on_message(msg);
+            ++count;
+            latency_.record(now > msg.timestamp_ns ? now - msg.timestamp_ns : 0);
+        });
+    messages_.fetch_add(count, std::memory_order_relaxed);
+    stream_.wake_waiters();
+
+    // A bad frame spoils only its own datagram
+    mcast_parser_.reset();
+}
+
+#endif
@@ -0,0 +1,47 @@
+#include "latency_histogram.hpp"
+
+void LatencyHistogram::snapshot(Counts& out) const {
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        out[i] = counts_[i].load(std::memory_order_relaxed);
+    }
+}
+
+uint64_t LatencyHistogram::upper_bound_of(size_t i) {
+    if (i < SUB_COUNT) {
+        return i;
+    }
+    const size_t shift = (i - SUB_COUNT) / SUB_COUNT;
+    const uint64_t mantissa = SUB_COUNT + (i - SUB_COUNT) % SUB_COUNT;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+LatencySummary LatencyHistogram::summarize(const Counts& now, const Counts& prev) {
+    LatencySummary s;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        s.count += now[i] - prev[i];
+    }
+    if (s.count == 0) {
+        return s;
+    }
+
+    // Rank (1-based) of each percentile within the interval
+    const uint64_t r50  = (s.count * 500 + 999) / 1000;
+    const uint64_t r99  = (s.count * 990 + 999) / 1000;
+    const uint64_t r999 = (s.count * 999 + 999) / 1000;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        const uint64_t n = now[i] - prev[i];
+        if (n == 0) {
+            continue;
+        }
+        const uint64_t before = seen;
+        seen += n;
+        const uint64_t value = upper_bound_of(i);
+        if (before < r50  && seen >= r50)  s.p50_ns  = value;
+        if (before < r99  && seen >= r99)  s.p99_ns  = value;
+        if (before < r999 && seen >= r999) s.p999_ns = value;
+        s.max_ns = value;
+    }
+    return s;
+}
@@ -0,0 +1,60 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+struct LatencySummary {
+    uint64_t count{0};
+    uint64_t p50_ns{0};
+    uint64_t p99_ns{0};
+    uint64_t p999_ns{0};
+    uint64_t max_ns{0};
+};
+
+// Log-linear (HDR-style) latency histogram: values below 32 ns get their own
+// bucket, above that every power of two is split into 32 linear sub-buckets,
+// so any recorded value is reported to within ~3%.
+//
+// Single writer: one histogram per recording thread. The writer bumps a
+// counter with a relaxed load/store (no locked instruction); readers copy
+// the cumulative counts at any time and diff two copies to get an interval.
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BITS = 5;
+    static constexpr uint64_t SUB_COUNT = 1ULL << SUB_BITS;
+    static constexpr size_t BUCKETS = SUB_COUNT + (64 - SUB_BITS) * SUB_COUNT;
+
+    using Counts = std::array<uint64_t, BUCKETS>;
+
+    // Writer side
+    void record(uint64_t value_ns) {
+        auto& c = counts_[bucket_of(value_ns)];
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Reader side
+    void snapshot(Counts& out) const;
+
+    // Percentiles of the values recorded between two snapshots
+    static LatencySummary summarize(const Counts& now, const Counts& prev);
+
+    static size_t bucket_of(uint64_t v) {
+        if (v < SUB_COUNT) {
+            return static_cast<size_t>(v);
+        }
+        const unsigned msb = 63 - static_cast<unsigned>(__builtin_clzll(v));
+        const unsigned shift = msb - SUB_BITS;
+        return SUB_COUNT + shift * SUB_COUNT + static_cast<size_t>((v >> shift) - SUB_COUNT);
+    }
+
+    // Largest value that maps to bucket i
+    static uint64_t upper_bound_of(size_t i);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> counts_{};
+};
+
+#endif
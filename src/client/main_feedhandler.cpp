@@ -1,12 +1,117 @@
 #include "feed_handler.hpp"
 #include "visualizer.hpp"
 
+#include <algorithm>
 #include <thread>
 #include <iostream>
+#include <string>
+#include <vector>
 
-int main() {
+// usage: feedhandler [--multicast [group:port]] [--recv epoll|uring|busy]
+//                    [--consumers N] [--symbols LIST] [--capture DIR]
+// --multicast takes data from the simulator's MULTICAST group on loopback
+// (default 239.255.0.1:9878); the TCP connection stays for control.
+// --recv picks the TCP receive path (see ReceiveMode).
+// --consumers starts N threads reading the full stream (FeedHandler::stream),
+// each tracking per symbol trade volume; their lag shows in the UI.
+// --symbols is the initial subscription, ids and ranges: 1-100,250 (default 1-100).
+// --capture records everything received into journal files under DIR
+// (see TickJournal), 16 files of 64 MiB at most.
+
+namespace {
+
+// "1-100,250" -> 1..100, 250
+std::vector<uint16_t> parse_symbols(const std::string& list) {
+    std::vector<uint16_t> symbols;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        const size_t comma = std::min(list.find(',', pos), list.size());
+        const std::string item = list.substr(pos, comma - pos);
+        const size_t dash = item.find('-');
+        const int first = std::stoi(item.substr(0, dash));
+        const int last  = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+        for (int s = first; s <= last; ++s) {
+            symbols.push_back(static_cast<uint16_t>(s));
+        }
+        pos = comma + 1;
+    }
+    return symbols;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
     try {
-        FeedHandler handler("127.0.0.1", 9876);
+        bool multicast = false;
+        int consumers = 0;
+        std::string group = "239.255.0.1";
+        uint16_t group_port = 9878;
+        ReceiveMode receive_mode = ReceiveMode::EPOLL;
+        std::string symbols = "1-100";
+        std::string capture_dir;
+
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--multicast") {
+                multicast = true;
+                if (i + 1 < argc && argv[i + 1][0] != '-') {
+                    const std::string addr = argv[++i];
+                    const size_t colon = addr.find(':');
+                    group = addr.substr(0, colon);
+                    if (colon != std::string::npos) {
+                        group_port = static_cast<uint16_t>(std::stoi(addr.substr(colon + 1)));
+                    }
+                }
+            } else if (arg == "--recv" && i + 1 < argc) {
+                const std::string mode = argv[++i];
+                if (mode == "uring") {
+                    receive_mode = ReceiveMode::IO_URING;
+                } else if (mode == "busy") {
+                    receive_mode = ReceiveMode::BUSY_POLL;
+                } else if (mode != "epoll") {
+                    std::cerr << "Unknown receive mode: " << mode << "\n";
+                    return 1;
+                }
+            } else if (arg == "--consumers" && i + 1 < argc) {
+                consumers = std::stoi(argv[++i]);
+            } else if (arg == "--symbols" && i + 1 < argc) {
+                symbols = argv[++i];
+            } else if (arg == "--capture" && i + 1 < argc) {
+                capture_dir = argv[++i];
+            } else {
+                std::cerr << "Unknown argument: " << arg << "\n";
+                return 1;
+            }
+        }
+
+        FeedHandler handler("127.0.0.1", 9876, 9877, PROTOCOL_VERSION_2, true, receive_mode);
+        if (multicast) {
+            handler.enable_multicast(group, group_port, "127.0.0.1");
+        }
+        if (!capture_dir.empty()) {
+            JournalConfig journal;
+            journal.directory = capture_dir;
+            handler.enable_capture(journal);
+        }
+        handler.subscribe(parse_symbols(symbols));
+
+        std::vector<std::thread> strategies;
+        for (int c = 0; c < consumers; ++c) {
+            BroadcastRing::Consumer* consumer = handler.stream().subscribe("consumer-" + std::to_string(c));
+            if (consumer == nullptr) {
+                break;
+            }
+            strategies.emplace_back([consumer]() {
+                std::vector<uint64_t> volume(1024);
+                MarketMessage msg;
+                while (true) {
+                    if (consumer->next_wait(msg, std::chrono::milliseconds(100)) &&
+                        msg.type == MessageType::TRADE && msg.symbol_id < volume.size()) {
+                        volume[msg.symbol_id] += msg.trade.trade_qty;
+                    }
+                }
+            });
+        }
 
         Visualizer viz(handler);
         std::thread ui([&]() { viz.run(); });
@@ -14,6 +119,9 @@ int main() {
         handler.run();
 
         ui.join();
+        for (auto& t : strategies) {
+            t.join();
+        }
     } catch (const std::exception& e) {
         std::cerr << "[FATAL] " << e.what() << "\n";
         return 1;
@@ -4,6 +4,7 @@
 // #include <unistd.h>
 // #include <fcntl.h>
 // #include <netinet/tcp.h>
+#include <sys/socket.h>
 // #include <cstring>
 // #include <cerrno>     // ✅ for errno, EINPROGRESS
 
@@ -51,12 +52,15 @@
 // }
 
 #include "market_data_socket.hpp"
+#include "../common/protocol.hpp"
 
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <netinet/tcp.h>
+#include <sys/socket.h>
 #include <cerrno>
+#include <algorithm>
 #include <vector>
 #include <cstring>
 
@@ -96,26 +100,72 @@ bool MarketDataSocket::connect_to(const char* host, uint16_t port) {
     return false;
 }
 
-bool MarketDataSocket::send_subscription(const std::vector<uint16_t>& symbols) {
+int MarketDataSocket::finish_connect() const {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &len) < 0) {
+        return errno;
+    }
+    return err;
+}
+
+// Symbols past MAX_SUBSCRIBE_COUNT follow in OPCODE_SUBSCRIBE_ADD frames
+bool MarketDataSocket::send_subscription(const std::vector<uint16_t>& symbols, uint8_t version, uint8_t flags) {
     std::vector<uint8_t> buf;
-    buf.reserve(1 + 2 + symbols.size() * 2);
+    buf.reserve(3 + 2 + symbols.size() * 2);
+
+    if (version <= PROTOCOL_VERSION_1) {
+        buf.push_back(OPCODE_SUBSCRIBE);
+    } else {
+        buf.push_back(OPCODE_SUBSCRIBE_V2);
+        buf.push_back(version);
+        buf.push_back(flags);
+    }
+
+    const size_t first = std::min<size_t>(symbols.size(), MAX_SUBSCRIBE_COUNT);
+    append_symbols(buf, symbols.data(), first);
+    if (symbols.size() > first) {
+        append_change(buf, OPCODE_SUBSCRIBE_ADD, symbols.data() + first, symbols.size() - first);
+    }
 
-    buf.push_back(0xFF);  // subscribe command
+    ssize_t sent = ::send(fd_, buf.data(), buf.size(), MSG_NOSIGNAL);
+    return sent == static_cast<ssize_t>(buf.size());
+}
+
+bool MarketDataSocket::send_subscription_change(uint8_t opcode, const std::vector<uint16_t>& symbols) {
+    std::vector<uint8_t> buf;
+    buf.reserve(3 * (symbols.size() / MAX_SUBSCRIBE_COUNT + 1) + symbols.size() * 2);
+    append_change(buf, opcode, symbols.data(), symbols.size());
 
-    uint16_t count = htons(symbols.size());
+    ssize_t sent = ::send(fd_, buf.data(), buf.size(), MSG_NOSIGNAL);
+    return sent == static_cast<ssize_t>(buf.size());
+}
+
+// [op][count u16][ids] frames of at most MAX_SUBSCRIBE_COUNT symbols. Only
+// the first frame of a REPLACE replaces, the rest add to it.
+void MarketDataSocket::append_change(std::vector<uint8_t>& buf, uint8_t opcode,
+                                     const uint16_t* symbols, size_t count) {
+    size_t done = 0;
+    do {
+        const size_t n = std::min<size_t>(count - done, MAX_SUBSCRIBE_COUNT);
+        buf.push_back(opcode == OPCODE_SUBSCRIBE_REPLACE && done != 0 ? OPCODE_SUBSCRIBE_ADD : opcode);
+        append_symbols(buf, symbols + done, n);
+        done += n;
+    } while (done < count);
+}
+
+void MarketDataSocket::append_symbols(std::vector<uint8_t>& buf, const uint16_t* symbols, size_t count) {
+    uint16_t n = htons(static_cast<uint16_t>(count));
     buf.insert(buf.end(),
-               reinterpret_cast<uint8_t*>(&count),
-               reinterpret_cast<uint8_t*>(&count) + sizeof(count));
+               reinterpret_cast<uint8_t*>(&n),
+               reinterpret_cast<uint8_t*>(&n) + sizeof(n));
 
-    for (uint16_t s : symbols) {
-        uint16_t sid = htons(s);
+    for (size_t i = 0; i < count; ++i) {
+        uint16_t sid = htons(symbols[i]);
         buf.insert(buf.end(),
                    reinterpret_cast<uint8_t*>(&sid),
                    reinterpret_cast<uint8_t*>(&sid) + sizeof(sid));
     }
-
-    ssize_t sent = ::send(fd_, buf.data(), buf.size(), 0);
-    return sent == static_cast<ssize_t>(buf.size());
 }
 
 
@@ -129,6 +179,11 @@ ssize_t MarketDataSocket::send_data(const void* buf, size_t len) {
     return ::send(fd_, buf, len, MSG_NOSIGNAL);
 }
 
+bool MarketDataSocket::enable_busy_poll(int usec) {
+    if (fd_ < 0) return false;
+    return setsockopt(fd_, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) == 0;
+}
+
 int MarketDataSocket::get_fd() const {
     return fd_;
 }
@@ -140,6 +195,77 @@ void MarketDataSocket::close() {
     }
 }
 
+bool MarketDataSocket::join_multicast(const char* group, uint16_t port, const char* iface) {
+    mcast_fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (mcast_fd_ < 0) {
+        return false;
+    }
+
+    // Several feed handlers on one host share the group port
+    int reuse = 1;
+    setsockopt(mcast_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Bursts arrive faster than one epoll wakeup drains them
+    int rcvbuf = 8 * 1024 * 1024;
+    setsockopt(mcast_fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    ip_mreq mreq{};
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(port);
+    if (inet_pton(AF_INET, group, &mreq.imr_multiaddr) != 1 ||
+        inet_pton(AF_INET, iface, &mreq.imr_interface) != 1) {
+        leave_multicast();
+        return false;
+    }
+    addr.sin_addr = mreq.imr_multiaddr;   // only the group's datagrams
+
+    if (bind(mcast_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        setsockopt(mcast_fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        leave_multicast();
+        return false;
+    }
+    return true;
+}
+
+int MarketDataSocket::recv_datagrams(uint8_t* bufs, size_t stride, size_t* sizes, size_t max) {
+    constexpr size_t MAX_BATCH = 64;
+    if (mcast_fd_ < 0) return -1;
+    if (max > MAX_BATCH) max = MAX_BATCH;
+
+    mmsghdr msgs[MAX_BATCH];
+    iovec iov[MAX_BATCH];
+    for (size_t i = 0; i < max; ++i) {
+        iov[i].iov_base = bufs + i * stride;
+        iov[i].iov_len  = stride;
+        msgs[i] = mmsghdr{};
+        msgs[i].msg_hdr.msg_iov    = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    const int n = recvmmsg(mcast_fd_, msgs, static_cast<unsigned>(max), MSG_DONTWAIT, nullptr);
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+    for (int i = 0; i < n; ++i) {
+        // A truncated datagram cannot be decoded: report it as empty
+        sizes[i] = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ? 0 : msgs[i].msg_len;
+    }
+    return n;
+}
+
+int MarketDataSocket::multicast_fd() const {
+    return mcast_fd_;
+}
+
+void MarketDataSocket::leave_multicast() {
+    if (mcast_fd_ >= 0) {
+        ::close(mcast_fd_);
+        mcast_fd_ = -1;
+    }
+}
+
 MarketDataSocket::~MarketDataSocket() {
     close();
+    leave_multicast();
 }
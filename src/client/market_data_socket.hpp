@@ -29,17 +29,46 @@ public:
     MarketDataSocket() = default;
     ~MarketDataSocket();
 
-    bool send_subscription(const std::vector<uint16_t>& symbols);
+    // version 1 sends the legacy subscribe frame, 2+ the negotiating one
+    // flags: SUBSCRIBE_FLAG_* bits, only sent with version >= 2
+    bool send_subscription(const std::vector<uint16_t>& symbols, uint8_t version = 1, uint8_t flags = 0);
 
+    // OPCODE_SUBSCRIBE_ADD / OPCODE_UNSUBSCRIBE / OPCODE_SUBSCRIBE_REPLACE on a
+    // subscribed connection
+    bool send_subscription_change(uint8_t opcode, const std::vector<uint16_t>& symbols);
+
+    // Starts a non-blocking connect; completion is signalled by EPOLLOUT
     bool connect_to(const char* host, uint16_t port);
+    // After EPOLLOUT: 0 if the connect succeeded, otherwise the socket error
+    int finish_connect() const;
     ssize_t recv_data(void* buf, size_t len);
     ssize_t send_data(const void* buf, size_t len);
 
     int get_fd() const;
     void close();
 
+    // SO_BUSY_POLL: recv() on an empty socket spins in the driver for up to
+    // usec before returning EAGAIN. May need CAP_NET_ADMIN.
+    bool enable_busy_poll(int usec);
+
+    // ---- Multicast receive mode: data on UDP, TCP kept for control ----
+    // Joins group:port on the local interface address (127.0.0.1 for
+    // loopback multicast). Non-blocking.
+    bool join_multicast(const char* group, uint16_t port, const char* iface);
+    // Up to max datagrams with one recvmmsg(): datagram i lands in
+    // bufs + i * stride and its length in sizes[i]. Returns the count,
+    // 0 if nothing is queued, -1 on error.
+    int recv_datagrams(uint8_t* bufs, size_t stride, size_t* sizes, size_t max);
+    int multicast_fd() const;
+    void leave_multicast();
+
 private:
+    static void append_change(std::vector<uint8_t>& buf, uint8_t opcode,
+                              const uint16_t* symbols, size_t count);
+    static void append_symbols(std::vector<uint8_t>& buf, const uint16_t* symbols, size_t count);
+
     int fd_{-1};
+    int mcast_fd_{-1};
 };
 
 #endif // MARKET_DATA_SOCKET_H
@@ -0,0 +1,67 @@
+#ifndef MESSAGE_HANDLER_H
+#define MESSAGE_HANDLER_H
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "../common/protocol.hpp"
+
+// Hooks an embedding application can give BasicFeedHandler<Handler>. They
+// are found at compile time and called inline on the network thread, as
+// each message passes the sequence check: no virtual call, no copy, no
+// handoff to another thread. A handler defines only the hooks it wants:
+//
+//   void on_quote(const MarketMessage&);
+//   void on_trade(const MarketMessage&);
+//   void on_depth(const MarketMessage&);
+//   void on_snapshot(const MarketMessage&);   // top of book (quote layout) as a symbol gets subscribed
+//   void on_gap(uint16_t symbol, uint64_t first, uint64_t last);   // sequences lost, recovery requested
+//
+//   static constexpr bool use_cache = false;   // skip the symbol cache and stream()
+//
+// Hooks run before the cache is updated and must not block: the socket is
+// not read while they run.
+struct NullHandler {};
+
+namespace handler_traits {
+
+template <typename H, typename = void>
+struct has_on_quote : std::false_type {};
+template <typename H>
+struct has_on_quote<H, std::void_t<decltype(std::declval<H&>().on_quote(std::declval<const MarketMessage&>()))>>
+    : std::true_type {};
+
+template <typename H, typename = void>
+struct has_on_trade : std::false_type {};
+template <typename H>
+struct has_on_trade<H, std::void_t<decltype(std::declval<H&>().on_trade(std::declval<const MarketMessage&>()))>>
+    : std::true_type {};
+
+template <typename H, typename = void>
+struct has_on_depth : std::false_type {};
+template <typename H>
+struct has_on_depth<H, std::void_t<decltype(std::declval<H&>().on_depth(std::declval<const MarketMessage&>()))>>
+    : std::true_type {};
+
+template <typename H, typename = void>
+struct has_on_snapshot : std::false_type {};
+template <typename H>
+struct has_on_snapshot<H, std::void_t<decltype(std::declval<H&>().on_snapshot(std::declval<const MarketMessage&>()))>>
+    : std::true_type {};
+
+template <typename H, typename = void>
+struct has_on_gap : std::false_type {};
+template <typename H>
+struct has_on_gap<H, std::void_t<decltype(std::declval<H&>().on_gap(uint16_t{}, uint64_t{}, uint64_t{}))>>
+    : std::true_type {};
+
+// The cache stays on unless the handler opts out
+template <typename H, typename = void>
+struct uses_cache : std::true_type {};
+template <typename H>
+struct uses_cache<H, std::void_t<decltype(H::use_cache)>> : std::bool_constant<H::use_cache> {};
+
+} // namespace handler_traits
+
+#endif
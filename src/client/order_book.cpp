@@ -0,0 +1,124 @@
+#include "order_book.hpp"
+
+namespace {
+
+// Ordering predicate: true if a is a better price than b on this side
+inline bool better(bool is_bid, double a, double b) {
+    return is_bid ? a > b : a < b;
+}
+
+// Replaces the level in slot i; qty == 0 clears it
+void set_level(BookLevels& side, uint32_t i, double price, uint32_t qty) {
+    for (uint32_t j = side.count; j < i; ++j) {
+        side.price[j] = 0.0;   // levels never received between the old and new depth
+        side.qty[j]   = 0;
+    }
+    side.price[i] = qty == 0 ? 0.0 : price;
+    side.qty[i]   = qty;
+    if (i >= side.count) {
+        side.count = i + 1;
+    }
+    while (side.count > 0 && side.qty[side.count - 1] == 0) {
+        --side.count;
+    }
+}
+
+// Clears the deeper levels priced at or better than the new top
+void clear_through(BookLevels& side, bool is_bid, double top) {
+    for (uint32_t i = 1; i < side.count; ++i) {
+        if (side.qty[i] != 0 && !better(is_bid, top, side.price[i])) {
+            side.price[i] = 0.0;
+            side.qty[i]   = 0;
+        }
+    }
+}
+
+// Level i was just replaced: older deeper levels not behind it, and older
+// shallower ones not ahead of it, are stale (the price moved since)
+void clear_around(BookLevels& side, bool is_bid, uint32_t i) {
+    for (uint32_t j = 1; j < side.count; ++j) {
+        if (j == i || side.qty[j] == 0) {
+            continue;
+        }
+        const bool in_order = j < i ? better(is_bid, side.price[j], side.price[i])
+                                    : better(is_bid, side.price[i], side.price[j]);
+        if (!in_order) {
+            side.price[j] = 0.0;
+            side.qty[j]   = 0;
+        }
+    }
+    while (side.count > 0 && side.qty[side.count - 1] == 0) {
+        --side.count;
+    }
+}
+
+} // namespace
+
+void OrderBook::apply(const MarketMessage& msg) {
+    switch (msg.type) {
+        case MessageType::QUOTE:
+        case MessageType::SNAPSHOT: apply_quote(msg); break;
+        case MessageType::TRADE: apply_trade(msg); break;
+        case MessageType::DEPTH: apply_depth(msg); break;
+        default: return;
+    }
+    last_sequence_ = msg.sequence;
+    timestamp_ns_  = msg.timestamp_ns;
+}
+
+void OrderBook::clear() {
+    bids_.count = 0;
+    asks_.count = 0;
+    last_sequence_ = 0;
+    timestamp_ns_  = 0;
+}
+
+void OrderBook::apply_quote(const MarketMessage& msg) {
+    const double bid = msg.quote.bid_price;
+    const double ask = msg.quote.ask_price;
+
+    // Deeper levels at or better than the new top are stale. Remaining bids
+    // sit below bid < ask and remaining asks above it, so the book cannot cross.
+    clear_through(bids_, true, bid);
+    clear_through(asks_, false, ask);
+    set_level(bids_, 0, bid, msg.quote.bid_qty);
+    set_level(asks_, 0, ask, msg.quote.ask_qty);
+}
+
+void OrderBook::apply_trade(const MarketMessage& msg) {
+    // A buy aggressor lifts the offers at or below its price, a sell
+    // aggressor hits the bids at or above it, best level first
+    const bool is_bid = !msg.trade.aggressor_buy;
+    BookLevels& side = is_bid ? bids_ : asks_;
+    uint32_t left = msg.trade.trade_qty;
+    for (uint32_t i = 0; i < side.count && left != 0; ++i) {
+        if (side.qty[i] == 0) {
+            continue;
+        }
+        if (better(is_bid, msg.trade.trade_price, side.price[i])) {
+            break;   // this level and every one behind it are past the trade price
+        }
+        // An emptied level stays empty until its next update; the others keep their slots
+        const uint32_t taken = left < side.qty[i] ? left : side.qty[i];
+        left -= taken;
+        set_level(side, i, side.price[i], side.qty[i] - taken);
+    }
+}
+
+void OrderBook::apply_depth(const MarketMessage& msg) {
+    const bool is_bid = msg.depth.side == BookSide::BID;
+    BookLevels& side = is_bid ? bids_ : asks_;
+
+    const uint32_t level = msg.depth.level;
+    if (level == 0 || level >= BookLevels::MAX_LEVELS) {
+        return;   // level 0 is the quote's; deeper than the book keeps
+    }
+    // Never let a depth level jump ahead of the quoted top of book
+    if (side.count > 0 && side.qty[0] != 0 && better(is_bid, msg.depth.price, side.price[0])) {
+        return;
+    }
+    set_level(side, level, msg.depth.price, msg.depth.qty);
+    if (msg.depth.qty != 0) {
+        clear_around(side, is_bid, level);
+    }
+}
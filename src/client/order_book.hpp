@@ -0,0 +1,49 @@
+#ifndef ORDER_BOOK_H
+#define ORDER_BOOK_H
+
+#include <cstddef>
+#include <cstdint>
+#include "../common/protocol.hpp"
+
+// Fixed-capacity price levels for one side, indexed by level: slot 0 is the
+// top of book, slot n the n-th level behind it, so slots are best price
+// first. qty 0 marks a level not (or no longer) known. Prices and
+// quantities are kept in separate arrays so a scan touches two cache lines
+// instead of walking interleaved level structs.
+struct BookLevels {
+    static constexpr size_t MAX_LEVELS = 16;
+
+    double   price[MAX_LEVELS];
+    uint32_t qty[MAX_LEVELS];
+    uint32_t count{0};   // slots in use: 1 + deepest known level
+};
+
+// L2 book for one symbol rebuilt from the QUOTE / TRADE / DEPTH stream.
+// QUOTE replaces level 0 of both sides, DEPTH replaces the level it names
+// and TRADE takes liquidity from the levels its price crosses. The server
+// sends no deletes: a level is current until its next update replaces it.
+// Older levels the new price has moved past (out of order next to the level
+// just replaced) are cleared, so the book is never crossed or misordered.
+// No allocation anywhere.
+class OrderBook {
+public:
+    void apply(const MarketMessage& msg);
+    void clear();
+
+    const BookLevels& bids() const { return bids_; }
+    const BookLevels& asks() const { return asks_; }
+    uint64_t last_sequence() const { return last_sequence_; }
+    uint64_t timestamp_ns() const { return timestamp_ns_; }
+
+private:
+    void apply_quote(const MarketMessage& msg);
+    void apply_trade(const MarketMessage& msg);
+    void apply_depth(const MarketMessage& msg);
+
+    BookLevels bids_;   // descending prices
+    BookLevels asks_;   // ascending prices
+    uint64_t last_sequence_{0};
+    uint64_t timestamp_ns_{0};
+};
+
+#endif
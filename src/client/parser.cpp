@@ -3,33 +3,265 @@
 #include <cstring>
 #include <arpa/inet.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PARSER_HAVE_SSSE3_PATH 1
+#endif
+
+namespace {
+
+// Each decoder handles up to n v1 messages and stops early at the first
+// record that is not v1 (non-zero first byte); returns how many it decoded.
+
+// Portable path: one message at a time
+size_t decode_block_scalar(const uint8_t* src, size_t n, MarketMessage* out) {
+    for (size_t i = 0; i < n; ++i) {
+        if (src[i * sizeof(MarketMessage)] != 0) {
+            return i;
+        }
+        MarketMessage wire;
+        std::memcpy(&wire, src + i * sizeof(MarketMessage), sizeof(MarketMessage));
+        out[i] = from_wire(wire);
+    }
+    return n;
+}
+
+#ifdef PARSER_HAVE_SSSE3_PATH
+// A 44-byte record is swapped as three 16-byte lanes with one pshufb each:
+//   [ 0,16)  type, symbol_id, sequence            (bytes 12..15 pass through)
+//   [12,28)  timestamp_ns, bid_price | trade_price
+//   [28,44)  ask_price, bid_qty, ask_qty | trade_qty, aggressor, padding
+//                                        | depth qty, side, level, padding
+// Lanes are loaded from the source before any store, so the overlap is safe.
+// Only the third lane depends on the message type; TRADE and DEPTH share a layout.
+__attribute__((target("ssse3")))
+size_t decode_block_ssse3(const uint8_t* src, size_t n, MarketMessage* out) {
+    const __m128i head = _mm_setr_epi8(1, 0, 3, 2, 11, 10, 9, 8, 7, 6, 5, 4, 12, 13, 14, 15);
+    const __m128i mid  = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    const __m128i tail_quote = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 11, 10, 9, 8, 15, 14, 13, 12);
+    const __m128i tail_trade = _mm_setr_epi8(3, 2, 1, 0, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+    uint8_t* dst = reinterpret_cast<uint8_t*>(out);
+    for (size_t i = 0; i < n; ++i) {
+        const uint8_t* s = src + i * sizeof(MarketMessage);
+        uint8_t* d = dst + i * sizeof(MarketMessage);
+        if (s[0] != 0) {
+            return i;
+        }
+
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 12));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 28));
+
+        // type is big-endian on the wire: low byte at offset 1
+        const bool is_trade = s[1] == static_cast<uint8_t>(MessageType::TRADE) ||
+                              s[1] == static_cast<uint8_t>(MessageType::DEPTH);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d), _mm_shuffle_epi8(a, head));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 12), _mm_shuffle_epi8(b, mid));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 28),
+                         _mm_shuffle_epi8(c, is_trade ? tail_trade : tail_quote));
+    }
+    return n;
+}
+
+bool cpu_has_ssse3() {
+    static const bool has = __builtin_cpu_supports("ssse3");
+    return has;
+}
+#endif
+
+size_t decode_block(const uint8_t* src, size_t n, MarketMessage* out) {
+#ifdef PARSER_HAVE_SSSE3_PATH
+    if (cpu_has_ssse3()) {
+        return decode_block_ssse3(src, n, out);
+    }
+#endif
+    return decode_block_scalar(src, n, out);
+}
+
+} // namespace
+
 ParseResult Parser::parse(const uint8_t* data, size_t len) {
     ParseResult result{};
+    result.status = ParseStatus::INCOMPLETE;
+    result.bytes_consumed = 0;
 
-    // Not enough data for even one message
-    if (len < sizeof(MarketMessage)) {
-        result.status = ParseStatus::INCOMPLETE;
-        result.bytes_consumed = 0;
+    if (len == 0) {
         return result;
     }
 
-    MarketMessage msg;
-    std::memcpy(&msg, data, sizeof(MarketMessage));
+    // ---- v2 batch header: skipped, the first frame behind it is returned ----
+    if (data[0] == v2::BATCH_MARKER) {
+        BatchInfo batch;
+        if (len < sizeof(v2::BatchHeader)) {
+            return result;
+        }
+        if (batch_remaining_ != 0 || !read_batch_header(data, batch)) {
+            malformed_ = true;
+            result.status = ParseStatus::MALFORMED;
+            return result;
+        }
+        // Nothing is consumed until the first frame is complete as well
+        const uint32_t remaining = batch_remaining_;
+        batch_           = batch;
+        batch_remaining_ = batch.count;
+        result = parse(data + sizeof(v2::BatchHeader), len - sizeof(v2::BatchHeader));
+        if (result.status == ParseStatus::OK) {
+            result.bytes_consumed += sizeof(v2::BatchHeader);
+        } else if (result.status == ParseStatus::INCOMPLETE) {
+            batch_remaining_ = remaining;
+        }
+        return result;
+    }
 
-    // ---- endian conversion ----
-    msg.symbol_id    = ntohs(msg.symbol_id);
-    msg.sequence     = be64toh(msg.sequence);
-    msg.timestamp_ns = be64toh(msg.timestamp_ns);
+    // ---- v2: variable-length frame, length comes first ----
+    if (data[0] != 0) {
+        if (len < sizeof(uint16_t)) {
+            return result;
+        }
+        const bool batched = batch_remaining_ != 0;
+        const size_t length = batched ? batched_frame_length(data) : v2_frame_length(data);
+        if (length == 0) {
+            malformed_ = true;
+            result.status = ParseStatus::MALFORMED;
+            return result;
+        }
+        if (len < length) {
+            return result;
+        }
+        result.bytes_consumed = length;
+        const bool ok = batched
+            ? v2::decode_batched(data, length, batch_.base_timestamp_ns, last_sequence_.data(), result.message)
+            : v2::decode(data, length, result.message);
+        if (!ok) {
+            malformed_ = true;
+            result.status = ParseStatus::MALFORMED;
+            return result;
+        }
+        if (batched) {
+            --batch_remaining_;
+        }
+        result.status = ParseStatus::OK;
+        return result;
+    }
 
-    // Sequence gap detection (report, not act)
-    if (last_sequence_ && msg.sequence != last_sequence_ + 1) {
-        // just detect for now
-        // feed handler decides what to do later
+    // ---- v1: fixed size ----
+    // Not enough data for even one message
+    if (len < sizeof(MarketMessage)) {
+        return result;
     }
-    last_sequence_ = msg.sequence;
 
+    MarketMessage wire;
+    std::memcpy(&wire, data, sizeof(MarketMessage));
+
+    // ---- endian conversion ----
+    result.message = from_wire(wire);
     result.status = ParseStatus::OK;
     result.bytes_consumed = sizeof(MarketMessage);
-    result.message = msg;
     return result;
 }
+
+bool Parser::read_batch_header(const uint8_t* data, BatchInfo& out) {
+    v2::BatchHeader h;
+    std::memcpy(&h, data, sizeof(h));
+    out.count             = le16toh(h.count);
+    out.length            = le32toh(h.length);
+    out.base_timestamp_ns = le64toh(h.base_timestamp_ns);
+    out.send_timestamp_ns = le64toh(h.send_timestamp_ns);
+    return h.version == PROTOCOL_VERSION_2 && out.count != 0 &&
+           out.length >= out.count * sizeof(v2::CompactHeader) &&
+           out.length <= out.count * v2::MAX_FRAME;
+}
+
+size_t Parser::batched_frame_length(const uint8_t* data) {
+    if (!(data[1] & v2::COMPACT_FLAG)) {
+        return v2_frame_length(data);
+    }
+    const size_t length = data[0];
+    if (length < sizeof(v2::CompactHeader) || length > v2::MAX_FRAME) {
+        return 0;
+    }
+    return length;
+}
+
+size_t Parser::v2_frame_length(const uint8_t* data) {
+    uint16_t length;
+    std::memcpy(&length, data, sizeof(length));
+    length = le16toh(length);
+    if (length < sizeof(v2::Header) || length > v2::MAX_FRAME) {
+        return 0;
+    }
+    return length;
+}
+
+size_t Parser::parse_batch(const uint8_t* data, size_t len,
+                           MarketMessage* out, size_t max_out, size_t& bytes_consumed) {
+    size_t n = 0;
+    size_t off = 0;
+
+    while (n < max_out && off < len) {
+        if (data[off] == 0) {
+            // v1 messages never appear inside a batch
+            if (batch_remaining_ != 0) {
+                malformed_ = true;
+                break;
+            }
+            // Run of v1 messages: decoded on the SIMD path until a v2 frame
+            size_t whole = (len - off) / MESSAGE_SIZE;
+            if (whole > max_out - n) {
+                whole = max_out - n;
+            }
+            const size_t run = decode_block(data + off, whole, out + n);
+            if (run == 0) {
+                break;   // partial v1 message
+            }
+            n   += run;
+            off += run * MESSAGE_SIZE;
+            continue;
+        }
+
+        if (data[off] == v2::BATCH_MARKER) {
+            if (len - off < sizeof(v2::BatchHeader)) {
+                break;
+            }
+            if (batch_remaining_ != 0 || !read_batch_header(data + off, batch_)) {
+                malformed_ = true;
+                break;
+            }
+            batch_remaining_ = batch_.count;
+            batch_pending_   = true;
+            off += sizeof(v2::BatchHeader);
+            break;   // hand the header to the caller before its frames
+        }
+
+        // v2 frame, compact or not inside a batch
+        if (len - off < sizeof(uint16_t)) {
+            break;
+        }
+        const bool batched = batch_remaining_ != 0;
+        const size_t length = batched ? batched_frame_length(data + off) : v2_frame_length(data + off);
+        if (length == 0) {
+            malformed_ = true;
+            break;
+        }
+        if (len - off < length) {
+            break;
+        }
+        const bool ok = batched
+            ? v2::decode_batched(data + off, length, batch_.base_timestamp_ns, last_sequence_.data(), out[n])
+            : v2::decode(data + off, length, out[n]);
+        if (!ok) {
+            malformed_ = true;
+            break;
+        }
+        ++n;
+        off += length;
+        if (batched) {
+            --batch_remaining_;
+        }
+    }
+
+    bytes_consumed = off;
+    return n;
+}
@@ -1,8 +1,11 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <utility>
 #include "../common/protocol.hpp"
 
 
@@ -20,15 +23,134 @@ struct ParseResult {
     MarketMessage message;
 };
 
+// Zero-copy view of one encoded message inside a receive buffer.
+// Fields are byte-swapped on access; nothing is copied until decode().
+struct MessageView {
+    const uint8_t* bytes;
+
+    MessageType type() const {
+        uint16_t v; std::memcpy(&v, bytes + offsetof(MarketMessage, type), sizeof(v));
+        return static_cast<MessageType>(ntohs(v));
+    }
+    uint16_t symbol_id() const {
+        uint16_t v; std::memcpy(&v, bytes + offsetof(MarketMessage, symbol_id), sizeof(v));
+        return ntohs(v);
+    }
+    uint64_t sequence() const {
+        uint64_t v; std::memcpy(&v, bytes + offsetof(MarketMessage, sequence), sizeof(v));
+        return be64toh(v);
+    }
+    uint64_t timestamp_ns() const {
+        uint64_t v; std::memcpy(&v, bytes + offsetof(MarketMessage, timestamp_ns), sizeof(v));
+        return be64toh(v);
+    }
+    MarketMessage decode() const {
+        MarketMessage wire;
+        std::memcpy(&wire, bytes, sizeof(wire));
+        return from_wire(wire);
+    }
+};
+
+// Header of a v2 batch frame (see protocol.hpp), host byte order
+struct BatchInfo {
+    uint16_t count;
+    uint32_t length;
+    uint64_t base_timestamp_ns;
+    uint64_t send_timestamp_ns;
+};
+
 class Parser {
 public:
+    static constexpr size_t MESSAGE_SIZE = sizeof(MarketMessage);
+    static constexpr size_t BATCH_SIZE = 64;   // records decoded per block by the callback API
+
     Parser() = default;
 
-    // Stateless parse
+    // One message of either protocol version (told apart by the first byte,
+    // see protocol.hpp). MALFORMED means the stream cannot be resynchronised.
+    // A batch header is skipped together with the frame that follows it.
+    // Both forms keep the per-connection state compact batch frames need,
+    // so one Parser should see a connection's stream from its start.
     ParseResult parse(const uint8_t* data, size_t len);
 
+    // Decodes every complete message in [data, data + len), at most max_out,
+    // into out[]. Returns the number of records and sets bytes_consumed.
+    // Runs of v1 messages are byte-swapped on SIMD lanes where available.
+    // Stops at a malformed frame and sets malformed(). Also stops right
+    // after a batch header, which is then available from take_batch().
+    size_t parse_batch(const uint8_t* data, size_t len,
+                       MarketMessage* out, size_t max_out, size_t& bytes_consumed);
+
+    // Callback form: fn(const MarketMessage&) for every complete message and
+    // on_batch(const BatchInfo&) for every batch header, in stream order.
+    // Returns the bytes consumed; a trailing partial message is left alone.
+    template <typename Fn, typename BatchFn>
+    size_t parse_batch(const uint8_t* data, size_t len, Fn&& fn, BatchFn&& on_batch) {
+        MarketMessage block[BATCH_SIZE];
+        size_t total = 0;
+        while (true) {
+            size_t consumed = 0;
+            const size_t n = parse_batch(data + total, len - total, block, BATCH_SIZE, consumed);
+            for (size_t i = 0; i < n; ++i) {
+                fn(block[i]);
+            }
+            total += consumed;
+            BatchInfo batch;
+            if (take_batch(batch)) {
+                on_batch(batch);
+            } else if (n < BATCH_SIZE) {
+                return total;
+            }
+        }
+    }
+
+    template <typename Fn>
+    size_t parse_batch(const uint8_t* data, size_t len, Fn&& fn) {
+        return parse_batch(data, len, std::forward<Fn>(fn), [](const BatchInfo&) {});
+    }
+
+    // Batch header met by the last parse_batch() call, once
+    bool take_batch(BatchInfo& out) {
+        if (!batch_pending_) {
+            return false;
+        }
+        out = batch_;
+        batch_pending_ = false;
+        return true;
+    }
+
+    // True once a malformed frame was seen; the caller should drop the stream
+    bool malformed() const { return malformed_; }
+    void reset() {
+        malformed_       = false;
+        batch_pending_   = false;
+        batch_remaining_ = 0;
+        last_sequence_.fill(0);
+    }
+
+    // View form, v1 stream only: fn(MessageView) without decoding anything
+    template <typename Fn>
+    size_t parse_views(const uint8_t* data, size_t len, Fn&& fn) const {
+        const size_t n = len / MESSAGE_SIZE;
+        for (size_t i = 0; i < n; ++i) {
+            fn(MessageView{data + i * MESSAGE_SIZE});
+        }
+        return n * MESSAGE_SIZE;
+    }
+
 private:
-    uint64_t last_sequence_{0};
+    // v2 length field, or 0 if it is out of range for any frame
+    static size_t v2_frame_length(const uint8_t* data);
+    // Decodes and sanity-checks a batch header
+    static bool read_batch_header(const uint8_t* data, BatchInfo& out);
+    // Length of the frame at data inside a batch (compact or v2), 0 if out of range
+    static size_t batched_frame_length(const uint8_t* data);
+
+    bool malformed_{false};
+    BatchInfo batch_{};
+    bool batch_pending_{false};
+    uint32_t batch_remaining_{0};   // frames of the current batch still to come
+    std::array<uint64_t, v2::SEQUENCE_SLOTS> last_sequence_{};   // per symbol, for compact frames
 };
 
 #endif
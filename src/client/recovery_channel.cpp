@@ -0,0 +1,155 @@
+#include "recovery_channel.hpp"
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <endian.h>
+#include <arpa/inet.h>
+
+#include <cerrno>
+#include <iostream>
+
+void RecoveryChannel::configure(const std::string& host, uint16_t port, int epoll_fd,
+                                ReplayFn on_replay, RangeEndFn on_range_end) {
+    host_ = host;
+    port_ = port;
+    epoll_fd_ = epoll_fd;
+    on_replay_ = std::move(on_replay);
+    on_range_end_ = std::move(on_range_end);
+}
+
+void RecoveryChannel::request(uint16_t symbol, uint64_t from, uint64_t to) {
+    if (port_ == 0) {
+        lost_.fetch_add(to - from + 1, std::memory_order_relaxed);
+        on_range_end_(symbol);
+        return;
+    }
+
+    RetransmitRequest req;
+    req.opcode        = OPCODE_RETRANSMIT;
+    req.symbol_id     = htons(symbol);
+    req.from_sequence = htobe64(from);
+    req.to_sequence   = htobe64(to);
+    unsent_.push_back(req);
+    outstanding_.push_back(Range{symbol, from, to, 0});
+
+    if (state_ == State::IDLE && !connect()) {
+        fail();
+        return;
+    }
+    if (state_ == State::CONNECTED) {
+        send_pending();
+    }
+}
+
+bool RecoveryChannel::connect() {
+    if (!socket_.connect_to(host_.c_str(), port_)) {
+        return false;
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    ev.data.fd = socket_.get_fd();
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket_.get_fd(), &ev) < 0) {
+        socket_.close();
+        return false;
+    }
+    state_ = State::CONNECTING;
+    return true;
+}
+
+void RecoveryChannel::on_event(uint32_t events) {
+    if (state_ == State::CONNECTING) {
+        if (socket_.finish_connect() != 0) {
+            std::cerr << "[Recovery] connect failed\n";
+            fail();
+            return;
+        }
+        state_ = State::CONNECTED;
+        send_pending();
+    }
+    if (state_ == State::CONNECTED && (events & EPOLLIN)) {
+        handle_read();
+    }
+    if (state_ == State::CONNECTED && (events & (EPOLLHUP | EPOLLERR))) {
+        fail();
+    }
+}
+
+// Requests are tiny; if the socket cannot take one whole the channel is
+// considered broken rather than tracking partial request frames
+void RecoveryChannel::send_pending() {
+    for (const RetransmitRequest& req : unsent_) {
+        if (socket_.send_data(&req, sizeof(req)) != static_cast<ssize_t>(sizeof(req))) {
+            fail();
+            return;
+        }
+    }
+    unsent_.clear();
+}
+
+void RecoveryChannel::handle_read() {
+    while (true) {
+        ssize_t bytes = socket_.recv_data(buffer_.write_ptr(), buffer_.free_space());
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                fail();
+            }
+            return;
+        }
+        if (bytes == 0) {
+            fail();
+            return;
+        }
+        buffer_.commit(static_cast<size_t>(bytes));
+
+        const size_t consumed = parser_.parse_batch(
+            buffer_.data_ptr(), buffer_.data_size(),
+            [this](const MarketMessage& msg) { on_reply(msg); });
+        buffer_.consume(consumed);
+
+        if (parser_.malformed()) {
+            fail();
+            return;
+        }
+    }
+}
+
+void RecoveryChannel::on_reply(const MarketMessage& msg) {
+    if (outstanding_.empty()) {
+        return;
+    }
+    Range& range = outstanding_.front();
+
+    if (msg.type == MessageType::RETRANSMIT_END) {
+        const uint64_t wanted = range.to - range.from + 1;
+        const uint16_t symbol = range.symbol;
+        lost_.fetch_add(wanted - range.received, std::memory_order_relaxed);
+        outstanding_.pop_front();
+        on_range_end_(symbol);
+        return;
+    }
+    ++range.received;
+    recovered_.fetch_add(1, std::memory_order_relaxed);
+    on_replay_(msg);
+}
+
+void RecoveryChannel::fail() {
+    if (socket_.get_fd() >= 0) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, socket_.get_fd(), nullptr);
+        socket_.close();
+    }
+    // Reset first: the callbacks may queue new requests
+    std::deque<Range> open;
+    open.swap(outstanding_);
+    unsent_.clear();
+    buffer_.consume(buffer_.data_size());
+    parser_.reset();
+    state_ = State::IDLE;
+
+    for (const Range& range : open) {
+        lost_.fetch_add(range.to - range.from + 1 - range.received, std::memory_order_relaxed);
+        on_range_end_(range.symbol);
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef RECOVERY_CHANNEL_H
+#define RECOVERY_CHANNEL_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "market_data_socket.hpp"
+#include "parser.hpp"
+#include "stream_buffer.hpp"
+#include "../common/protocol.hpp"
+
+// Client side of the simulator's retransmit port. Gaps found on the live
+// feed are turned into RetransmitRequests; the connection is opened lazily
+// on the first gap and runs on the feed handler's epoll loop.
+//
+// Replayed messages go to the replay callback, in order; the feed handler
+// merges them with the live ticks it holds back for the symbol. Every
+// requested range ends with exactly one range_end callback: on its
+// RETRANSMIT_END, or when it is written off (no recovery port, connect or
+// socket failure, abandon()). The server answers requests in order, so one
+// FIFO of outstanding ranges is enough to match replies. Recovered vs. lost
+// is accounted here.
+class RecoveryChannel {
+public:
+    using ReplayFn   = std::function<void(const MarketMessage&)>;
+    using RangeEndFn = std::function<void(uint16_t symbol)>;
+
+    RecoveryChannel() = default;
+
+    void configure(const std::string& host, uint16_t port, int epoll_fd,
+                   ReplayFn on_replay, RangeEndFn on_range_end);
+
+    // Queue [from, to] of symbol; connects if needed. May end the range
+    // (range_end callback) before returning.
+    void request(uint16_t symbol, uint64_t from, uint64_t to);
+
+    // Writes off every open range, e.g. when the feed reconnects
+    void abandon() { fail(); }
+
+    int fd() const { return socket_.get_fd(); }
+    void on_event(uint32_t events);
+
+    uint64_t recovered() const { return recovered_.load(std::memory_order_relaxed); }
+    uint64_t lost() const { return lost_.load(std::memory_order_relaxed); }
+
+private:
+    enum class State { IDLE, CONNECTING, CONNECTED };
+
+    struct Range {
+        uint16_t symbol;
+        uint64_t from;
+        uint64_t to;
+        uint64_t received;
+    };
+
+    bool connect();
+    void send_pending();
+    void handle_read();
+    void on_reply(const MarketMessage& msg);
+    void fail();   // closes and writes every open range off as lost
+
+    MarketDataSocket socket_;
+    std::string host_;
+    uint16_t port_{0};
+    int epoll_fd_{-1};
+    State state_{State::IDLE};
+    ReplayFn on_replay_;
+    RangeEndFn on_range_end_;
+
+    std::vector<RetransmitRequest> unsent_;   // queued while connecting
+    std::deque<Range> outstanding_;           // sent, waiting for RETRANSMIT_END
+
+    Parser parser_;
+    StreamBuffer buffer_{64 * 1024};
+
+    std::atomic<uint64_t> recovered_{0};
+    std::atomic<uint64_t> lost_{0};
+};
+
+#endif
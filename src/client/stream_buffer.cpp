@@ -0,0 +1,69 @@
+#include "stream_buffer.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+size_t round_up_pow2_pages(size_t bytes) {
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t size = page;
+    while (size < bytes) {
+        size <<= 1;
+    }
+    return size;
+}
+
+} // namespace
+
+StreamBuffer::StreamBuffer(size_t capacity)
+    : capacity_(round_up_pow2_pages(capacity)),
+      mask_(capacity_ - 1)
+{
+    int fd = memfd_create("feed_stream_buffer", MFD_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("StreamBuffer: memfd_create failed: " + std::string(strerror(errno)));
+    }
+    if (ftruncate(fd, static_cast<off_t>(capacity_)) < 0) {
+        ::close(fd);
+        throw std::runtime_error("StreamBuffer: ftruncate failed: " + std::string(strerror(errno)));
+    }
+
+    // Reserve 2x address space, then map the same pages into both halves
+    void* region = mmap(nullptr, 2 * capacity_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("StreamBuffer: address reservation failed");
+    }
+
+    uint8_t* base = static_cast<uint8_t*>(region);
+    void* lo = mmap(base, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    void* hi = mmap(base + capacity_, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    ::close(fd);   // the mappings keep the memory alive
+
+    if (lo == MAP_FAILED || hi == MAP_FAILED) {
+        munmap(region, 2 * capacity_);
+        throw std::runtime_error("StreamBuffer: mirror mapping failed");
+    }
+    base_ = base;
+}
+
+StreamBuffer::~StreamBuffer() {
+    if (base_ != nullptr) {
+        munmap(base_, 2 * capacity_);
+    }
+}
+
+bool StreamBuffer::append(const uint8_t* data, size_t len) {
+    if (len > free_space()) {
+        return false;
+    }
+    std::memcpy(write_ptr(), data, len);
+    commit(len);
+    return true;
+}
@@ -0,0 +1,45 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Byte ring mapped twice back to back in virtual memory (memfd + two mmaps),
+// so [data_ptr(), data_ptr() + data_size()) and [write_ptr(), write_ptr() +
+// free_space()) are always contiguous, even across the wrap point.
+// recv() writes straight into write_ptr() and the parser reads straight from
+// data_ptr(): no staging copy and no compaction.
+class StreamBuffer {
+public:
+    // capacity is rounded up to a power-of-two number of pages (mask_ indexing)
+    explicit StreamBuffer(size_t capacity = 64 * 1024);
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // Reader side
+    const uint8_t* data_ptr() const { return base_ + (head_ & mask_); }
+    size_t data_size() const { return static_cast<size_t>(tail_ - head_); }
+    void consume(size_t n) { head_ += n; }
+
+    // Writer side: fill up to free_space() bytes at write_ptr(), then commit()
+    uint8_t* write_ptr() { return base_ + (tail_ & mask_); }
+    size_t free_space() const { return capacity_ - data_size(); }
+    void commit(size_t n) { tail_ += n; }
+
+    // Copying append for callers that do not own the receive call.
+    // Returns false (and copies nothing) if len exceeds free_space().
+    bool append(const uint8_t* data, size_t len);
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    uint8_t* base_{nullptr};
+    size_t capacity_{0};
+    size_t mask_{0};
+    uint64_t head_{0};   // next byte to parse
+    uint64_t tail_{0};   // next byte to receive into
+};
+
+#endif
@@ -0,0 +1,285 @@
+#include "tick_journal.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t MIN_FILE_BYTES = 1u << 20;
+constexpr size_t SYNC_GRANULE = 2u << 20;
+
+size_t page_size() {
+    static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return page;
+}
+
+uint64_t clock_ns(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+} // namespace
+
+TickJournal::TickJournal(const JournalConfig& config) : config_(config) {
+    if (config_.directory.empty()) {
+        throw std::runtime_error("TickJournal: no directory");
+    }
+    const size_t page = page_size();
+    config_.file_bytes = (std::max(config_.file_bytes, MIN_FILE_BYTES) + page - 1) / page * page;
+
+    if (mkdir(config_.directory.c_str(), 0755) < 0 && errno != EEXIST) {
+        throw std::runtime_error("TickJournal: mkdir " + config_.directory + " failed: " + strerror(errno));
+    }
+
+    // Files of one run share the start time: ticks-20240101-093000-000001.journal
+    const time_t now = time(nullptr);
+    tm local;
+    localtime_r(&now, &local);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+    session_ = stamp;
+
+    Segment* first = create_segment();
+    if (first == nullptr) {
+        throw std::runtime_error("TickJournal: cannot create a file in " + config_.directory);
+    }
+    spare_.store(first, std::memory_order_release);
+    thread_ = std::thread([this] { background(); });
+}
+
+TickJournal::~TickJournal() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+// Network thread, once per file: swaps in the spare the background thread
+// prepared and hands the full file back to it
+bool TickJournal::rotate(size_t need) {
+    if (sizeof(FileHeader) + need > config_.file_bytes) {
+        return false;   // would not fit in an empty file either
+    }
+    Segment* next = spare_.exchange(nullptr, std::memory_order_acq_rel);
+    if (next == nullptr) {
+        return false;
+    }
+    // current_ moves on before the old file is retired: once retired, the
+    // background thread may finish and free it
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        current_.store(next, std::memory_order_release);
+        if (active_ != nullptr) {
+            retired_.push_back(active_);
+        }
+        need_spare_ = true;
+    }
+    wake_.notify_one();
+
+    active_ = next;
+    offset_ = sizeof(FileHeader);
+    return true;
+}
+
+void TickJournal::background() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait_for(lock, std::chrono::milliseconds(config_.sync_ms),
+                       [this] { return stop_ || need_spare_ || !retired_.empty(); });
+        const bool stopping = stop_;
+        need_spare_ = false;
+        std::vector<Segment*> retired;
+        retired.swap(retired_);
+        lock.unlock();
+
+        for (Segment* seg : retired) {
+            finish(seg);
+        }
+
+        // The network thread is gone by now: the current file is final
+        if (stopping) {
+            if (Segment* seg = current_.exchange(nullptr, std::memory_order_acq_rel)) {
+                finish(seg);
+            }
+            if (Segment* seg = spare_.exchange(nullptr, std::memory_order_acq_rel)) {
+                discard(seg);
+            }
+            return;
+        }
+
+        if (Segment* seg = current_.load(std::memory_order_acquire)) {
+            sync(*seg, false);
+        }
+        // Right after a rotation, and every interval while a create fails
+        if (spare_.load(std::memory_order_acquire) == nullptr) {
+            if (Segment* seg = create_segment()) {
+                spare_.store(seg, std::memory_order_release);
+            }
+        }
+        lock.lock();
+    }
+}
+
+TickJournal::Segment* TickJournal::create_segment() {
+    char name[32];
+    snprintf(name, sizeof(name), "-%06llu.journal", static_cast<unsigned long long>(next_index_));
+    const std::string path = config_.directory + "/" + config_.prefix + "-" + session_ + name;
+
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror(("journal open " + path).c_str());
+        return nullptr;
+    }
+    // Reserve the blocks now so a full disk shows up here, not as SIGBUS
+    // on the network thread; ftruncate alone where fallocate is unsupported
+    int rc = posix_fallocate(fd, 0, static_cast<off_t>(config_.file_bytes));
+    if (rc == EOPNOTSUPP || rc == EINVAL) {
+        rc = ftruncate(fd, static_cast<off_t>(config_.file_bytes)) < 0 ? errno : 0;
+    }
+    void* map = rc == 0
+        ? mmap(nullptr, config_.file_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+        : MAP_FAILED;
+    if (map == MAP_FAILED) {
+        if (rc != 0) {
+            errno = rc;
+        }
+        perror(("journal map " + path).c_str());
+        ::close(fd);
+        unlink(path.c_str());
+        return nullptr;
+    }
+
+    // Write fault every page here rather than on the network thread
+    uint8_t* base = static_cast<uint8_t*>(map);
+    for (size_t off = 0; off < config_.file_bytes; off += page_size()) {
+        reinterpret_cast<volatile uint8_t*>(base)[off] = 0;
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version             = VERSION;
+    header.header_bytes        = sizeof(FileHeader);
+    header.file_index          = next_index_;
+    header.created_realtime_ns = clock_ns(CLOCK_REALTIME);
+    header.created_steady_ns   = clock_ns(CLOCK_MONOTONIC);
+    std::memcpy(base, &header, sizeof(header));
+
+    Segment* seg = new Segment;
+    seg->fd   = fd;
+    seg->base = base;
+    seg->size = config_.file_bytes;
+    seg->path = path;
+    ++next_index_;
+    files_.fetch_add(1, std::memory_order_relaxed);
+    return seg;
+}
+
+// Writes back what was appended since the last sync, from the page the
+// previous sync ended in (it may have grown since). Writeback write-protects
+// what it cleans, a whole page cache folio at a time (up to 2 MiB), and the
+// network thread's next append there would fault. So while the file grows,
+// only up to the last SYNC_GRANULE boundary behind the write offset; all of
+// it once the file is full or stopped growing since the last interval.
+void TickJournal::sync(Segment& seg, bool all) {
+    const size_t written = seg.written.load(std::memory_order_acquire);
+    const bool idle = written == seg.seen;
+    seg.seen = written;
+    const size_t to = all || idle ? written : written / SYNC_GRANULE * SYNC_GRANULE;
+    if (to <= seg.synced) {
+        return;
+    }
+    const size_t from = seg.synced / page_size() * page_size();
+    if (msync(seg.base + from, to - from, MS_SYNC) < 0) {
+        perror("journal msync");
+        return;
+    }
+    seg.synced = to;
+#ifdef MADV_POPULATE_WRITE
+    // Synced to the write offset: fault the cleaned folio writable again
+    // here, without touching its contents, before the network thread does
+    if (to == written && !all) {
+        const size_t page = to / page_size() * page_size();
+        madvise(seg.base + page, std::min(SYNC_GRANULE, seg.size - page), MADV_POPULATE_WRITE);
+    }
+#endif
+}
+
+// A full (or the last) file: synced, trimmed to what it holds and counted
+// against max_files
+void TickJournal::finish(Segment* seg) {
+    sync(*seg, true);
+    const size_t written = seg->written.load(std::memory_order_acquire);
+    munmap(seg->base, seg->size);
+    if (ftruncate(seg->fd, static_cast<off_t>(written)) < 0) {
+        perror("journal ftruncate");
+    }
+    ::close(seg->fd);
+
+    kept_.push_back(seg->path);
+    while (config_.max_files != 0 && kept_.size() > config_.max_files) {
+        unlink(kept_.front().c_str());
+        kept_.pop_front();
+    }
+    delete seg;
+}
+
+// A spare that never received data
+void TickJournal::discard(Segment* seg) {
+    munmap(seg->base, seg->size);
+    ::close(seg->fd);
+    unlink(seg->path.c_str());
+    files_.fetch_sub(1, std::memory_order_relaxed);
+    delete seg;
+}
+
+bool TickJournal::read_file(const std::string& path,
+                            const std::function<void(const RecordHeader&, const uint8_t*)>& fn) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+        ::close(fd);
+        return false;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    const uint8_t* base = static_cast<const uint8_t*>(map);
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    const bool valid = std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                       header.version == VERSION && header.header_bytes >= sizeof(FileHeader);
+    if (valid) {
+        size_t off = header.header_bytes;
+        while (off + sizeof(RecordHeader) <= size) {
+            RecordHeader record;
+            std::memcpy(&record, base + off, sizeof(record));
+            const size_t padded = (static_cast<size_t>(record.length) + 7) & ~size_t{7};
+            // Zero length: end marker. Past the end: cut short by a crash
+            if (record.length == 0 || off + sizeof(RecordHeader) + padded > size) {
+                break;
+            }
+            fn(record, base + off + sizeof(RecordHeader));
+            off += sizeof(RecordHeader) + padded;
+        }
+    }
+    munmap(map, size);
+    return valid;
+}
@@ -0,0 +1,160 @@
+#ifndef TICK_JOURNAL_H
+#define TICK_JOURNAL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class JournalSource : uint16_t {
+    TCP       = 1,   // bytes of one recv() / io_uring completion, frames may straddle records
+    MULTICAST = 2    // one whole datagram
+};
+
+struct JournalConfig {
+    std::string directory;
+    std::string prefix{"ticks"};
+    size_t file_bytes{64u << 20};   // pre-allocated size of each file
+    uint32_t max_files{16};         // finished files kept, oldest deleted first; 0 = keep all
+    uint32_t sync_ms{100};          // background msync interval
+};
+
+// Capture of the received byte stream into pre-allocated, memory-mapped,
+// rotating files. The network thread only copies into the mapping: no
+// syscall, and no page fault either: every page is write-faulted before the
+// file is handed over, and msync keeps clear of the pages still being
+// written (see sync()). A background thread does everything else: creates,
+// maps and pre-faults the next file ahead of time, msyncs what was written,
+// trims finished files to their used length and deletes the oldest.
+//
+// File layout (little-endian):
+//   FileHeader (64 bytes)
+//   records: RecordHeader (16 bytes) | payload, padded to 8 bytes
+//   a zero length ends the file (the pre-allocated tail is zeros)
+//
+// Data is in the page cache as soon as it is copied, so it survives the
+// process being killed; msync only bounds what a machine crash loses.
+// If the background thread has not got the next file ready when one fills
+// up, records are dropped and counted rather than waiting.
+class TickJournal {
+public:
+    static constexpr char MAGIC[8] = {'F', 'H', 'J', 'R', 'N', 'L', '0', '1'};
+    static constexpr uint32_t VERSION = 1;
+
+#pragma pack(push, 1)
+    struct FileHeader {
+        char     magic[8];
+        uint32_t version;
+        uint32_t header_bytes;        // offset of the first record
+        uint64_t file_index;          // 1, 2, ... within the session
+        uint64_t created_realtime_ns; // pairs with created_steady_ns to convert recv_ns to wall time
+        uint64_t created_steady_ns;
+        uint8_t  reserved[24];
+    };
+
+    struct RecordHeader {
+        uint32_t length;    // payload bytes, 0 = end of file
+        uint16_t source;    // JournalSource
+        uint16_t reserved;
+        uint64_t recv_ns;   // steady clock, as in the feed handler's latency stats
+    };
+#pragma pack(pop)
+    static_assert(sizeof(FileHeader) == 64, "FileHeader layout");
+    static_assert(sizeof(RecordHeader) == 16, "RecordHeader layout");
+
+    // Creates the directory's first file and starts the background thread;
+    // throws std::runtime_error if the file cannot be created
+    explicit TickJournal(const JournalConfig& config);
+    ~TickJournal();   // syncs and trims the current file
+
+    TickJournal(const TickJournal&) = delete;
+    TickJournal& operator=(const TickJournal&) = delete;
+
+    // Network thread
+    void append(JournalSource source, const uint8_t* data, size_t len, uint64_t recv_ns) {
+        const size_t need = sizeof(RecordHeader) + ((len + 7) & ~size_t{7});
+        if (active_ == nullptr || offset_ + need > active_->size) {
+            if (!rotate(need)) {
+                dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        uint8_t* at = active_->base + offset_;
+        const RecordHeader header{static_cast<uint32_t>(len), static_cast<uint16_t>(source), 0, recv_ns};
+        std::memcpy(at + sizeof(RecordHeader), data, len);
+        std::memcpy(at, &header, sizeof(header));
+        offset_ += need;
+        active_->written.store(offset_, std::memory_order_release);
+
+        records_.store(records_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        bytes_.store(bytes_.load(std::memory_order_relaxed) + len, std::memory_order_relaxed);
+    }
+
+    // Any thread
+    uint64_t records() const { return records_.load(std::memory_order_relaxed); }
+    uint64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t files() const { return files_.load(std::memory_order_relaxed); }   // created, including the spare
+    bool spare_ready() const { return spare_.load(std::memory_order_acquire) != nullptr; }   // next file prepared
+    const JournalConfig& config() const { return config_; }
+
+    // Offline reader: fn(const RecordHeader&, const uint8_t* payload) for
+    // every record of one file, in order. False if the file is not a journal.
+    static bool read_file(const std::string& path,
+                          const std::function<void(const RecordHeader&, const uint8_t*)>& fn);
+
+private:
+    struct Segment {
+        int fd{-1};
+        uint8_t* base{nullptr};
+        size_t size{0};
+        std::string path;
+        std::atomic<size_t> written{sizeof(FileHeader)};   // bytes in use, set by the network thread
+        size_t synced{0};                                  // background thread only
+        size_t seen{0};                                    // written at the last sync, ditto
+    };
+
+    bool rotate(size_t need);
+
+    // background thread
+    void background();
+    Segment* create_segment();
+    void sync(Segment& seg, bool all);
+    void finish(Segment* seg);
+    void discard(Segment* seg);
+
+    JournalConfig config_;
+    std::string session_;
+    uint64_t next_index_{1};   // background thread (and the constructor)
+
+    // network thread
+    Segment* active_{nullptr};
+    size_t offset_{0};
+
+    std::atomic<Segment*> current_{nullptr};   // active_, for the background sync
+    std::atomic<Segment*> spare_{nullptr};     // next file, mapped and ready
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::vector<Segment*> retired_;   // full files waiting to be finished, guarded by mutex_
+    bool need_spare_{false};          // guarded by mutex_
+    bool stop_{false};                // guarded by mutex_
+    std::deque<std::string> kept_;    // finished files, oldest first (background thread)
+
+    alignas(64) std::atomic<uint64_t> records_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> files_{0};
+
+    std::thread thread_;
+};
+
+#endif
@@ -0,0 +1,207 @@
+#include "uring_receiver.hpp"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+
+namespace {
+
+int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+} // namespace
+
+// Creating a ring is not enough: provided buffer rings arrived in 5.19 and
+// multishot receive in 6.0, and an older kernel only rejects them once
+// open() registers and arms them. Registers (and drops) a test buffer ring,
+// then asks IORING_REGISTER_PROBE for RECV and for SEND_ZC, the opcode
+// 6.0 added with multishot receive; the probe has no per-flag answer.
+bool UringReceiver::supported() {
+    io_uring_params params{};
+    const int fd = io_uring_setup(1, &params);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+
+    if (ok) {
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        void* ring = mmap(nullptr, page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        io_uring_buf_reg reg{};
+        reg.ring_addr    = reinterpret_cast<uint64_t>(ring);
+        reg.ring_entries = 1;
+        reg.bgid         = BUFFER_GROUP;
+        ok = ring != MAP_FAILED && io_uring_register(fd, IORING_REGISTER_PBUF_RING, &reg, 1) == 0;
+        if (ok) {
+            io_uring_register(fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        }
+        if (ring != MAP_FAILED) {
+            munmap(ring, page);
+        }
+    }
+
+    if (ok) {
+        constexpr unsigned PROBE_OPS = 256;
+        alignas(io_uring_probe) uint8_t storage[sizeof(io_uring_probe) + PROBE_OPS * sizeof(io_uring_probe_op)]{};
+        const io_uring_probe* probe = reinterpret_cast<const io_uring_probe*>(storage);
+        const auto has = [probe](unsigned op) {
+            return op <= probe->last_op && op < probe->ops_len &&
+                   (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+        };
+        ok = io_uring_register(fd, IORING_REGISTER_PROBE, storage, PROBE_OPS) == 0 &&
+             has(IORING_OP_RECV) && has(IORING_OP_SEND_ZC);
+    }
+    ::close(fd);
+    return ok;
+}
+
+bool UringReceiver::open(int socket_fd) {
+    io_uring_params params{};
+    ring_fd_ = io_uring_setup(RING_ENTRIES, &params);
+    if (ring_fd_ < 0) {
+        return false;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        close();
+        errno = ENOSYS;
+        return false;
+    }
+
+    // ---- rings: SQ and CQ share one mapping ----
+    const size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    const size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sq_ring_size_ = sq_size > cq_size ? sq_size : cq_size;
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        close();
+        return false;
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        close();
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    uint8_t* ring = static_cast<uint8_t*>(sq_ring_);
+    sq_tail_  = reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+    sq_array_ = reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+    sq_mask_  = *reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+    cq_head_  = reinterpret_cast<unsigned*>(ring + params.cq_off.head);
+    cq_tail_  = reinterpret_cast<unsigned*>(ring + params.cq_off.tail);
+    cq_mask_  = *reinterpret_cast<unsigned*>(ring + params.cq_off.ring_mask);
+    cqes_     = reinterpret_cast<io_uring_cqe*>(ring + params.cq_off.cqes);
+
+    // ---- provided buffer ring + the buffers it hands out ----
+    const size_t ring_bytes = BUFFER_COUNT * sizeof(io_uring_buf);
+    void* bufs = mmap(nullptr, ring_bytes + BUFFER_COUNT * BUFFER_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (bufs == MAP_FAILED) {
+        close();
+        return false;
+    }
+    buf_ring_ = static_cast<io_uring_buf*>(bufs);
+    buf_tail_ = reinterpret_cast<uint16_t*>(reinterpret_cast<uint8_t*>(buf_ring_) +
+                                            offsetof(io_uring_buf, resv));
+    buffers_  = static_cast<uint8_t*>(bufs) + ring_bytes;
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr    = reinterpret_cast<uint64_t>(buf_ring_);
+    reg.ring_entries = BUFFER_COUNT;
+    reg.bgid         = BUFFER_GROUP;
+    if (io_uring_register(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        close();
+        return false;
+    }
+
+    buf_tail_local_ = 0;
+    for (unsigned i = 0; i < BUFFER_COUNT; ++i) {
+        recycle(static_cast<uint16_t>(i));
+    }
+    __atomic_store_n(buf_tail_, buf_tail_local_, __ATOMIC_RELEASE);
+
+    // ---- the socket as fixed file 0 ----
+    if (io_uring_register(ring_fd_, IORING_REGISTER_FILES, &socket_fd, 1) < 0) {
+        close();
+        return false;
+    }
+
+    if (!arm_recv()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void UringReceiver::close() {
+    if (buf_ring_ != nullptr) {
+        munmap(buf_ring_, BUFFER_COUNT * sizeof(io_uring_buf) + BUFFER_COUNT * BUFFER_SIZE);
+        buf_ring_ = nullptr;
+        buf_tail_ = nullptr;
+        buffers_  = nullptr;
+    }
+    if (sqes_ != nullptr) {
+        munmap(sqes_, sqes_size_);
+        sqes_ = nullptr;
+    }
+    if (sq_ring_ != nullptr) {
+        munmap(sq_ring_, sq_ring_size_);
+        sq_ring_ = nullptr;
+    }
+    // Closing the ring cancels the armed receive and drops the registrations
+    if (ring_fd_ >= 0) {
+        ::close(ring_fd_);
+        ring_fd_ = -1;
+    }
+}
+
+UringReceiver::~UringReceiver() {
+    close();
+}
+
+// One multishot receive: completions keep coming (IORING_CQE_F_MORE) until
+// an error, EOF or the buffer ring running dry ends it.
+bool UringReceiver::arm_recv() {
+    const unsigned tail = *sq_tail_;
+    const unsigned index = tail & sq_mask_;
+
+    io_uring_sqe& sqe = sqes_[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode    = IORING_OP_RECV;
+    sqe.fd        = 0;   // fixed file index
+    sqe.flags     = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+    sqe.ioprio    = IORING_RECV_MULTISHOT;
+    sqe.buf_group = BUFFER_GROUP;
+
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    return enter(1, 0, 0) == 1;
+}
+
+int UringReceiver::enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+    int rc;
+    do {
+        rc = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete,
+                                      flags, nullptr, 0));
+    } while (rc < 0 && errno == EINTR);
+    return rc;
+}
+
+// Buffer ids map one to one onto BUFFER_SIZE slices of buffers_
+void UringReceiver::recycle(uint16_t bid) {
+    io_uring_buf& entry = buf_ring_[buf_tail_local_ & (BUFFER_COUNT - 1)];
+    entry.addr = reinterpret_cast<uint64_t>(buffer(bid));
+    entry.len  = static_cast<uint32_t>(BUFFER_SIZE);
+    entry.bid  = bid;
+    ++buf_tail_local_;
+}
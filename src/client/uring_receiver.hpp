@@ -0,0 +1,116 @@
+#ifndef URING_RECEIVER_H
+#define URING_RECEIVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+#include <linux/io_uring.h>
+
+// io_uring receive path for one TCP socket, without liburing.
+//
+// A single multishot IORING_OP_RECV stays armed for the life of the
+// connection. The kernel picks a buffer from a registered provided-buffer
+// ring for each completion, so there is no recv() call and no per-read
+// submission. The socket is registered as a fixed file. The ring fd is
+// pollable: it goes in the FeedHandler's epoll set in place of the socket.
+class UringReceiver {
+public:
+    static constexpr unsigned RING_ENTRIES = 8;
+    static constexpr unsigned BUFFER_COUNT = 64;          // power of two
+    static constexpr size_t   BUFFER_SIZE  = 16 * 1024;
+    static constexpr uint16_t BUFFER_GROUP = 0;
+
+    enum class Status {
+        OK,
+        CLOSED,   // peer closed the connection
+        FAILED    // receive error, errno is set
+    };
+
+    UringReceiver() = default;
+    ~UringReceiver();
+
+    UringReceiver(const UringReceiver&) = delete;
+    UringReceiver& operator=(const UringReceiver&) = delete;
+
+    // True if the running kernel has everything open() uses: a ring with a
+    // single mapping, provided buffer rings and multishot receive
+    static bool supported();
+
+    // Sets up the rings and buffers for socket_fd and arms the receive
+    bool open(int socket_fd);
+    void close();
+
+    int fd() const { return ring_fd_; }
+
+    // fn(const uint8_t* data, size_t len) for every completed receive, in
+    // order. A buffer goes back to the kernel once fn returns. Re-arms the
+    // receive if the kernel ended it (e.g. it ran out of buffers).
+    template <typename Fn>
+    Status drain(Fn&& fn) {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            // Completions may still be pending as task work
+            enter(0, 0, IORING_ENTER_GETEVENTS);
+            tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        }
+
+        Status status = Status::OK;
+        bool rearm = false;
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+                const uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                fn(buffer(bid), static_cast<size_t>(cqe.res));
+                recycle(bid);
+            } else if (cqe.res == 0) {
+                status = Status::CLOSED;
+            } else if (cqe.res < 0 && cqe.res != -ENOBUFS) {
+                errno = -cqe.res;
+                status = Status::FAILED;
+            }
+            if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                rearm = true;
+            }
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        __atomic_store_n(buf_tail_, buf_tail_local_, __ATOMIC_RELEASE);
+
+        if (status == Status::OK && rearm && !arm_recv()) {
+            status = Status::FAILED;
+        }
+        return status;
+    }
+
+private:
+    bool arm_recv();
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags);
+
+    uint8_t* buffer(uint16_t bid) const { return buffers_ + static_cast<size_t>(bid) * BUFFER_SIZE; }
+    void recycle(uint16_t bid);
+
+    int ring_fd_{-1};
+
+    // submission queue
+    void* sq_ring_{nullptr};
+    size_t sq_ring_size_{0};
+    io_uring_sqe* sqes_{nullptr};
+    size_t sqes_size_{0};
+    unsigned* sq_tail_{nullptr};
+    unsigned* sq_array_{nullptr};
+    unsigned sq_mask_{0};
+
+    // completion queue (shares the sq mapping)
+    unsigned* cq_head_{nullptr};
+    unsigned* cq_tail_{nullptr};
+    io_uring_cqe* cqes_{nullptr};
+    unsigned cq_mask_{0};
+
+    // provided buffers
+    io_uring_buf* buf_ring_{nullptr};   // BUFFER_COUNT entries
+    uint16_t* buf_tail_{nullptr};       // overlays buf_ring_[0].resv
+    uint16_t buf_tail_local_{0};
+    uint8_t* buffers_{nullptr};         // BUFFER_COUNT * BUFFER_SIZE
+};
+
+#endif
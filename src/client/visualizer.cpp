@@ -30,12 +30,84 @@ void Visualizer::run() {
         std::cout << "\033[2J\033[H";
 
         std::cout << "=== NSE Market Data Feed Handler ===\n";
-        std::cout << "Connected to: localhost:9876\n";
+        switch (feed_handler_.connection_state()) {
+            case ConnectionState::CONNECTED:
+                std::cout << "Connected to: localhost:9876\n";
+                break;
+            case ConnectionState::CONNECTING:
+                std::cout << "Connecting to: localhost:9876 (cache stale)\n";
+                break;
+            case ConnectionState::BACKOFF:
+                std::cout << "Disconnected, retrying (cache stale)\n";
+                break;
+        }
+        std::cout << "Reconnect attempts: " << feed_handler_.reconnect_count() << "\n";
+        std::cout << "Subscribed symbols: " << feed_handler_.subscribed_count()
+                  << " (snapshots " << feed_handler_.snapshot_count() << ")\n";
         std::cout << "Uptime: " << uptime << " sec\n\n";
 
         std::cout << "Messages Processed: " << total << "\n";
         std::cout << "Receive Rate:       " << rate << " msg/sec\n";
-        std::cout << "Sequence Gaps:      " << feed_handler_.sequence_gaps() << "\n";
+        std::cout << "Sequence Gaps:      " << feed_handler_.sequence_gaps()
+                  << " (recovered " << feed_handler_.recovered_count()
+                  << ", lost " << feed_handler_.lost_count()
+                  << ", duplicates dropped " << feed_handler_.duplicate_count() << ")\n";
+        if (feed_handler_.withheld_count() != 0) {
+            std::cout << "Conflated Away:     " << feed_handler_.withheld_count() << " (server GAP_FILL)\n";
+        }
+        if (feed_handler_.multicast_enabled()) {
+            std::cout << "Multicast Packets:  " << feed_handler_.multicast_packet_count()
+                      << " (missing " << feed_handler_.packet_gaps() << ")\n";
+        }
+        if (const TickJournal* journal = feed_handler_.journal()) {
+            std::cout << "Captured:           " << journal->records() << " reads, "
+                      << (journal->bytes() >> 20) << " MiB in " << journal->files() << " files"
+                      << " (dropped " << journal->dropped() << ")\n";
+        }
+
+        // Latency over the last window only: diff against the previous copy
+        LatencyHistogram::Counts latency_now;
+        feed_handler_.latency_histogram().snapshot(latency_now);
+        LatencySummary lat = LatencyHistogram::summarize(latency_now, latency_prev_);
+        latency_prev_ = latency_now;
+
+        std::cout << "\nLatency (exchange -> cache, us)\n";
+        std::cout << std::fixed << std::setprecision(1)
+                  << "  p50: "   << lat.p50_ns  / 1e3
+                  << "  p99: "   << lat.p99_ns  / 1e3
+                  << "  p99.9: " << lat.p999_ns / 1e3
+                  << "  max: "   << lat.max_ns  / 1e3
+                  << "  (" << lat.count << " samples)\n";
+
+        // Batch frames: one per server flush when the feed is batched
+        const uint64_t batches = feed_handler_.batch_count();
+        const uint64_t batched = feed_handler_.batched_message_count();
+        if (batches != 0) {
+            feed_handler_.batch_latency_histogram().snapshot(latency_now);
+            LatencySummary blat = LatencyHistogram::summarize(latency_now, batch_latency_prev_);
+            batch_latency_prev_ = latency_now;
+
+            const uint64_t window = batches - batches_prev_;
+            std::cout << "\nBatches: " << window * 2 << "/sec, "
+                      << (window ? static_cast<double>(batched - batched_messages_prev_) / window : 0.0)
+                      << " msgs/batch\n";
+            std::cout << "  flush -> decode p50: " << blat.p50_ns / 1e3
+                      << "  p99: " << blat.p99_ns / 1e3 << " us\n";
+            batches_prev_ = batches;
+            batched_messages_prev_ = batched;
+        }
+
+        // Stream consumers: how far behind the network thread each one is
+        const std::vector<ConsumerStats> consumers = feed_handler_.stream().consumer_stats();
+        if (!consumers.empty()) {
+            std::cout << "\nStream Consumers\n";
+            for (const ConsumerStats& c : consumers) {
+                std::cout << "  " << std::left << std::setw(12) << c.name << std::right
+                          << " consumed " << c.consumed
+                          << "  lag " << c.lag
+                          << "  overruns " << c.overruns << "\n";
+            }
+        }
 
         std::cout << "\nPress Ctrl+C to exit\n";
         std::cout.flush();
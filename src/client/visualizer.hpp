@@ -21,6 +21,10 @@ public:
 private:
     const FeedHandler& feed_handler_;
     std::chrono::steady_clock::time_point start_time;
+    LatencyHistogram::Counts latency_prev_{};   // cumulative counts at the last refresh
+    LatencyHistogram::Counts batch_latency_prev_{};
+    uint64_t batches_prev_{0};
+    uint64_t batched_messages_prev_{0};
 };
 
 #endif
\ No newline at end of file
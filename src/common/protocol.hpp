@@ -42,12 +42,25 @@
 #ifndef PROTOCOL_H
 #define PROTOCOL_H
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <endian.h>
+#include <arpa/inet.h>
 
 enum class MessageType : uint16_t {
     QUOTE = 1,
     TRADE = 2,
-    HEARTBEAT = 3
+    HEARTBEAT = 3,
+    DEPTH = 4,           // one price level below the top of book
+    RETRANSMIT_END = 5,  // recovery channel: requested range fully replayed
+    GAP_FILL = 6,        // sequences of symbol_id up to `sequence` were withheld on purpose
+    SNAPSHOT = 7         // quote layout: top of book of symbol_id as of `sequence` (the anchor)
+};
+
+enum class BookSide : uint8_t {
+    BID = 0,
+    ASK = 1
 };
 
 #pragma pack(push, 1)
@@ -70,9 +83,456 @@ struct MarketMessage {
             uint32_t trade_qty;
             uint8_t aggressor_buy;
         } trade;
+
+        struct {
+            double price;
+            uint32_t qty;     // 0 removes the level
+            BookSide side;
+            uint8_t level;    // 1 = first level behind the top of book
+        } depth;
     };
 };
 #pragma pack(pop)
 
+// Client -> server control frames start with a one byte opcode
+constexpr uint8_t OPCODE_SUBSCRIBE    = 0xFF;   // [op][count u16][symbol u16 * count], v1 feed
+constexpr uint8_t OPCODE_RETRANSMIT   = 0xFE;   // RetransmitRequest, recovery port only
+constexpr uint8_t OPCODE_SUBSCRIBE_V2 = 0xFD;   // [op][version u8][flags u8][count u16][symbol u16 * count]
+
+// Changes to a live subscription, [op][count u16][symbol u16 * count]. They
+// keep the version and flags negotiated by the first subscription frame.
+constexpr uint8_t OPCODE_SUBSCRIBE_ADD     = 0xFC;   // add the symbols
+constexpr uint8_t OPCODE_UNSUBSCRIBE       = 0xFB;   // drop the symbols
+constexpr uint8_t OPCODE_SUBSCRIBE_REPLACE = 0xFA;   // exactly these symbols; count 0 drops all
+
+// Most symbols one subscription frame may carry; larger sets take several frames
+constexpr uint16_t MAX_SUBSCRIBE_COUNT = 500;
+
+// Feed versions a client can ask for in OPCODE_SUBSCRIBE_V2; the server
+// answers with min(requested, PROTOCOL_VERSION_MAX)
+constexpr uint8_t PROTOCOL_VERSION_1   = 1;   // fixed 44-byte MarketMessage, big-endian
+constexpr uint8_t PROTOCOL_VERSION_2   = 2;   // variable-length frames, see namespace v2
+constexpr uint8_t PROTOCOL_VERSION_MAX = PROTOCOL_VERSION_2;
+
+// OPCODE_SUBSCRIBE_V2 flags
+constexpr uint8_t SUBSCRIBE_FLAG_BATCH     = 0x01;   // v2 only: wrap each server flush in a v2::BatchHeader
+constexpr uint8_t SUBSCRIBE_FLAG_MULTICAST = 0x02;   // data comes from the multicast group, TCP is control only
+constexpr uint8_t SUBSCRIBE_FLAG_SNAPSHOT  = 0x04;   // a SNAPSHOT for every symbol as it gets subscribed
+
+// Sequence numbers are per symbol and start at 1. A retransmit request asks
+// for [from_sequence, to_sequence] of one symbol; the server replays what it
+// still holds, in order, then sends RETRANSMIT_END carrying to_sequence.
+// All fields big-endian.
+#pragma pack(push, 1)
+struct RetransmitRequest {
+    uint8_t  opcode;
+    uint16_t symbol_id;
+    uint64_t from_sequence;
+    uint64_t to_sequence;
+};
+#pragma pack(pop)
+
+static inline uint64_t htond(double d) {
+    uint64_t x;
+    std::memcpy(&x, &d, sizeof(x));
+    return htobe64(x);
+}
+
+static inline double ntohd(uint64_t x) {
+    x = be64toh(x);
+    double d;
+    std::memcpy(&d, &x, sizeof(d));
+    return d;
+}
+
+// Whole-message conversion between host and network byte order.
+// Doubles travel as big-endian IEEE-754 bit patterns.
+static inline MarketMessage to_wire(const MarketMessage& host) {
+    MarketMessage wire = host;
+    wire.type         = static_cast<MessageType>(htons(static_cast<uint16_t>(host.type)));
+    wire.symbol_id    = htons(host.symbol_id);
+    wire.sequence     = htobe64(host.sequence);
+    wire.timestamp_ns = htobe64(host.timestamp_ns);
+
+    if (host.type == MessageType::TRADE) {
+        uint64_t tp = htond(host.trade.trade_price);
+        std::memcpy(&wire.trade.trade_price, &tp, sizeof(tp));
+        wire.trade.trade_qty = htonl(host.trade.trade_qty);
+    } else if (host.type == MessageType::DEPTH) {
+        uint64_t p = htond(host.depth.price);
+        std::memcpy(&wire.depth.price, &p, sizeof(p));
+        wire.depth.qty = htonl(host.depth.qty);
+    } else {
+        uint64_t bp = htond(host.quote.bid_price);
+        uint64_t ap = htond(host.quote.ask_price);
+        std::memcpy(&wire.quote.bid_price, &bp, sizeof(bp));
+        std::memcpy(&wire.quote.ask_price, &ap, sizeof(ap));
+        wire.quote.bid_qty = htonl(host.quote.bid_qty);
+        wire.quote.ask_qty = htonl(host.quote.ask_qty);
+    }
+    return wire;
+}
+
+static inline MarketMessage from_wire(const MarketMessage& wire) {
+    MarketMessage host = wire;
+    host.type         = static_cast<MessageType>(ntohs(static_cast<uint16_t>(wire.type)));
+    host.symbol_id    = ntohs(wire.symbol_id);
+    host.sequence     = be64toh(wire.sequence);
+    host.timestamp_ns = be64toh(wire.timestamp_ns);
+
+    uint64_t bits;
+    if (host.type == MessageType::TRADE) {
+        std::memcpy(&bits, &wire.trade.trade_price, sizeof(bits));
+        host.trade.trade_price = ntohd(bits);
+        host.trade.trade_qty   = ntohl(wire.trade.trade_qty);
+    } else if (host.type == MessageType::DEPTH) {
+        std::memcpy(&bits, &wire.depth.price, sizeof(bits));
+        host.depth.price = ntohd(bits);
+        host.depth.qty   = ntohl(wire.depth.qty);
+    } else {
+        std::memcpy(&bits, &wire.quote.bid_price, sizeof(bits));
+        host.quote.bid_price = ntohd(bits);
+        std::memcpy(&bits, &wire.quote.ask_price, sizeof(bits));
+        host.quote.ask_price = ntohd(bits);
+        host.quote.bid_qty   = ntohl(wire.quote.bid_qty);
+        host.quote.ask_qty   = ntohl(wire.quote.ask_qty);
+    }
+    return host;
+}
+
+// ---------------------------------------------------------------------------
+// Protocol v2: variable-length frames.
+//
+//   Header (22 bytes): length u16 | version u8 | type u8 | symbol_id u16 |
+//                      sequence u64 | timestamp_ns u64
+//   QUOTE  +16: bid_price u32 | ask_price u32 | bid_qty u32 | ask_qty u32 (SNAPSHOT too)
+//   TRADE   +9: price u32 | qty u32 | aggressor_buy u8
+//   DEPTH  +10: price u32 | qty u32 | side u8 | level u8
+//   HEARTBEAT / RETRANSMIT_END / GAP_FILL: header only
+//
+// length covers the whole frame. Integers are little-endian, which is the
+// byte order of every host we run on, so decoding is plain loads. Prices are
+// fixed point: price * PRICE_SCALE as u32.
+//
+// Frames are shorter than 256 bytes, so a v2 frame never starts with a zero
+// byte while a v1 message always does (type is a big-endian u16 < 256).
+// That lets one parser accept both versions frame by frame.
+//
+// A client that subscribes with SUBSCRIBE_FLAG_BATCH gets everything queued
+// for it during one server flush as a single batch:
+//
+//   BatchHeader (24 bytes): marker u8 | version u8 | count u16 |
+//                           length u32 | base_timestamp_ns u64 | send_timestamp_ns u64
+//
+// followed by count frames totalling length bytes. The marker is above
+// MAX_FRAME, so it cannot be mistaken for a frame length. Inside a batch a
+// frame is usually compact, the same body behind a 10 byte header:
+//
+//   CompactHeader (10 bytes): length u8 | type u8 (| COMPACT_FLAG) | symbol_id u16 |
+//                             sequence_delta i16 | timestamp_delta i32
+//
+// sequence_delta is from the previous frame of the same symbol on this
+// connection, timestamp_delta in ns from base_timestamp_ns. A frame whose
+// deltas do not fit, or the first of its symbol, goes as an ordinary v2
+// frame; its second byte (length high byte) is 0 where a compact frame's
+// has COMPACT_FLAG set. Decoding a batch needs the connection's earlier
+// frames, like TCP itself.
+//
+// Multicast distribution sends the same frames in UDP datagrams:
+//
+//   PacketHeader (18 bytes): packet_sequence u64 | send_timestamp_ns u64 | count u16
+//
+// followed by count whole v2 frames. packet_sequence counts datagrams from
+// 1 per publisher, so a receiver can tell a lost datagram from a quiet feed.
+// ---------------------------------------------------------------------------
+namespace v2 {
+
+constexpr double PRICE_SCALE = 10000.0;
+
+#pragma pack(push, 1)
+struct Header {
+    uint16_t length;
+    uint8_t  version;
+    uint8_t  type;
+    uint16_t symbol_id;
+    uint64_t sequence;
+    uint64_t timestamp_ns;
+};
+
+struct Quote {
+    Header   header;
+    uint32_t bid_price;
+    uint32_t ask_price;
+    uint32_t bid_qty;
+    uint32_t ask_qty;
+};
+
+struct Trade {
+    Header   header;
+    uint32_t price;
+    uint32_t qty;
+    uint8_t  aggressor_buy;
+};
+
+struct Depth {
+    Header   header;
+    uint32_t price;
+    uint32_t qty;
+    uint8_t  side;
+    uint8_t  level;
+};
+
+struct BatchHeader {
+    uint8_t  marker;              // BATCH_MARKER
+    uint8_t  version;
+    uint16_t count;               // frames in the batch
+    uint32_t length;              // bytes of those frames, header excluded
+    uint64_t base_timestamp_ns;   // compact frames' timestamps are relative to it
+    uint64_t send_timestamp_ns;   // stamped when the batch was flushed
+};
+
+struct CompactHeader {
+    uint8_t  length;
+    uint8_t  type;                // MessageType | COMPACT_FLAG
+    uint16_t symbol_id;
+    int16_t  sequence_delta;      // from the symbol's previous frame on the connection
+    int32_t  timestamp_delta;     // ns from the batch's base_timestamp_ns
+};
+
+struct PacketHeader {
+    uint64_t packet_sequence;
+    uint64_t send_timestamp_ns;
+    uint16_t count;               // frames in the datagram
+};
+#pragma pack(pop)
+
+constexpr size_t MAX_FRAME = sizeof(Quote);
+static_assert(MAX_FRAME < 256, "v1/v2 detection relies on frames below 256 bytes");
+
+constexpr uint8_t  BATCH_MARKER    = 0xBA;
+constexpr uint16_t MAX_BATCH_COUNT = 0xFFFF;
+static_assert(BATCH_MARKER > MAX_FRAME, "batch marker must not look like a frame length");
+
+constexpr uint8_t COMPACT_FLAG   = 0x80;
+constexpr size_t  SEQUENCE_SLOTS = 1024;   // symbol ids with sequence deltas; above, full frames
+static_assert(sizeof(CompactHeader) == 10, "CompactHeader layout");
+
+static inline BatchHeader make_batch_header(uint16_t count, uint32_t length,
+                                            uint64_t base_timestamp_ns, uint64_t send_timestamp_ns) {
+    BatchHeader b;
+    b.marker            = BATCH_MARKER;
+    b.version           = PROTOCOL_VERSION_2;
+    b.count             = htole16(count);
+    b.length            = htole32(length);
+    b.base_timestamp_ns = htole64(base_timestamp_ns);
+    b.send_timestamp_ns = htole64(send_timestamp_ns);
+    return b;
+}
+
+// Expected frame length for a type, 0 if the type is unknown
+static inline size_t frame_size(MessageType type) {
+    switch (type) {
+        case MessageType::QUOTE:
+        case MessageType::SNAPSHOT:       return sizeof(Quote);
+        case MessageType::TRADE:          return sizeof(Trade);
+        case MessageType::DEPTH:          return sizeof(Depth);
+        case MessageType::HEARTBEAT:
+        case MessageType::RETRANSMIT_END:
+        case MessageType::GAP_FILL:       return sizeof(Header);
+    }
+    return 0;
+}
+
+static inline uint32_t to_fixed(double price) {
+    const double scaled = price * PRICE_SCALE + 0.5;
+    if (scaled <= 0.0) return 0;
+    if (scaled >= 4294967295.0) return 0xFFFFFFFFu;
+    return static_cast<uint32_t>(scaled);
+}
+
+static inline double from_fixed(uint32_t fixed) {
+    return static_cast<double>(fixed) / PRICE_SCALE;
+}
+
+// Encodes a host-order message into out (at least MAX_FRAME bytes),
+// returns the frame length
+static inline size_t encode(const MarketMessage& host, uint8_t* out) {
+    const size_t length = frame_size(host.type);
+
+    Header h;
+    h.length       = htole16(static_cast<uint16_t>(length));
+    h.version      = PROTOCOL_VERSION_2;
+    h.type         = static_cast<uint8_t>(host.type);
+    h.symbol_id    = htole16(host.symbol_id);
+    h.sequence     = htole64(host.sequence);
+    h.timestamp_ns = htole64(host.timestamp_ns);
+
+    switch (host.type) {
+        case MessageType::QUOTE:
+        case MessageType::SNAPSHOT: {
+            Quote q;
+            q.header    = h;
+            q.bid_price = htole32(to_fixed(host.quote.bid_price));
+            q.ask_price = htole32(to_fixed(host.quote.ask_price));
+            q.bid_qty   = htole32(host.quote.bid_qty);
+            q.ask_qty   = htole32(host.quote.ask_qty);
+            std::memcpy(out, &q, sizeof(q));
+            break;
+        }
+        case MessageType::TRADE: {
+            Trade t;
+            t.header        = h;
+            t.price         = htole32(to_fixed(host.trade.trade_price));
+            t.qty           = htole32(host.trade.trade_qty);
+            t.aggressor_buy = host.trade.aggressor_buy;
+            std::memcpy(out, &t, sizeof(t));
+            break;
+        }
+        case MessageType::DEPTH: {
+            Depth d;
+            d.header = h;
+            d.price  = htole32(to_fixed(host.depth.price));
+            d.qty    = htole32(host.depth.qty);
+            d.side   = static_cast<uint8_t>(host.depth.side);
+            d.level  = host.depth.level;
+            std::memcpy(out, &d, sizeof(d));
+            break;
+        }
+        default:
+            std::memcpy(out, &h, sizeof(h));
+            break;
+    }
+    return length;
+}
+
+// Body of a frame, the bytes behind its header, into out's union
+static inline void decode_body(MessageType type, const uint8_t* body, MarketMessage& out) {
+    uint32_t f[4];
+    switch (type) {
+        case MessageType::QUOTE:
+        case MessageType::SNAPSHOT:
+            std::memcpy(f, body, sizeof(f));
+            out.quote.bid_price = from_fixed(le32toh(f[0]));
+            out.quote.ask_price = from_fixed(le32toh(f[1]));
+            out.quote.bid_qty   = le32toh(f[2]);
+            out.quote.ask_qty   = le32toh(f[3]);
+            break;
+        case MessageType::TRADE:
+            std::memcpy(f, body, 2 * sizeof(uint32_t));
+            out.trade.trade_price   = from_fixed(le32toh(f[0]));
+            out.trade.trade_qty     = le32toh(f[1]);
+            out.trade.aggressor_buy = body[8];
+            break;
+        case MessageType::DEPTH:
+            std::memcpy(f, body, 2 * sizeof(uint32_t));
+            out.depth.price = from_fixed(le32toh(f[0]));
+            out.depth.qty   = le32toh(f[1]);
+            out.depth.side  = static_cast<BookSide>(body[8]);
+            out.depth.level = body[9];
+            break;
+        default:
+            break;
+    }
+}
+
+// Decodes one complete frame whose length field has already been checked
+// against len. Returns false for a wrong version, unknown type or a length
+// that does not match the type.
+static inline bool decode(const uint8_t* frame, size_t len, MarketMessage& out) {
+    Header h;
+    std::memcpy(&h, frame, sizeof(h));
+    const MessageType type = static_cast<MessageType>(h.type);
+    if (h.version != PROTOCOL_VERSION_2 || frame_size(type) != len) {
+        return false;
+    }
+
+    std::memset(&out, 0, sizeof(out));
+    out.type         = type;
+    out.symbol_id    = le16toh(h.symbol_id);
+    out.sequence     = le64toh(h.sequence);
+    out.timestamp_ns = le64toh(h.timestamp_ns);
+    decode_body(type, frame + sizeof(Header), out);
+    return true;
+}
+
+// Timestamp of an encoded frame, without decoding it
+static inline uint64_t frame_timestamp(const uint8_t* frame) {
+    uint64_t ts;
+    std::memcpy(&ts, frame + offsetof(Header, timestamp_ns), sizeof(ts));
+    return le64toh(ts);
+}
+
+// Re-encodes a complete v2 frame for a batch based at base_ns. last_sequence
+// holds the previous sequence of each symbol sent on the connection (0 =
+// none yet) and is updated either way. Returns the compact length, or 0 if
+// the frame has to go as it is.
+static inline size_t encode_batched(const uint8_t* frame, size_t len, uint64_t base_ns,
+                                    uint64_t* last_sequence, uint8_t* out) {
+    Header h;
+    std::memcpy(&h, frame, sizeof(h));
+    const uint16_t symbol = le16toh(h.symbol_id);
+    if (symbol >= SEQUENCE_SLOTS) {
+        return 0;
+    }
+    const uint64_t sequence = le64toh(h.sequence);
+    const uint64_t previous = last_sequence[symbol];
+    last_sequence[symbol] = sequence;
+
+    const int64_t seq_delta = static_cast<int64_t>(sequence - previous);
+    const int64_t ts_delta  = static_cast<int64_t>(le64toh(h.timestamp_ns) - base_ns);
+    if (previous == 0 || h.version != PROTOCOL_VERSION_2 || len < sizeof(Header) ||
+        seq_delta < INT16_MIN || seq_delta > INT16_MAX ||
+        ts_delta < INT32_MIN || ts_delta > INT32_MAX) {
+        return 0;
+    }
+
+    CompactHeader c;
+    c.length          = static_cast<uint8_t>(len - sizeof(Header) + sizeof(CompactHeader));
+    c.type            = static_cast<uint8_t>(h.type | COMPACT_FLAG);
+    c.symbol_id       = h.symbol_id;
+    c.sequence_delta  = static_cast<int16_t>(htole16(static_cast<uint16_t>(seq_delta)));
+    c.timestamp_delta = static_cast<int32_t>(htole32(static_cast<uint32_t>(ts_delta)));
+    std::memcpy(out, &c, sizeof(c));
+    std::memcpy(out + sizeof(c), frame + sizeof(Header), len - sizeof(Header));
+    return c.length;
+}
+
+// Decodes one complete frame inside a batch based at base_ns: compact, or
+// an ordinary v2 frame. Keeps last_sequence in step with encode_batched().
+static inline bool decode_batched(const uint8_t* frame, size_t len, uint64_t base_ns,
+                                  uint64_t* last_sequence, MarketMessage& out) {
+    if (!(frame[1] & COMPACT_FLAG)) {
+        if (!decode(frame, len, out)) {
+            return false;
+        }
+        if (out.symbol_id < SEQUENCE_SLOTS) {
+            last_sequence[out.symbol_id] = out.sequence;
+        }
+        return true;
+    }
+
+    CompactHeader c;
+    std::memcpy(&c, frame, sizeof(c));
+    const MessageType type = static_cast<MessageType>(c.type & ~COMPACT_FLAG);
+    const uint16_t symbol = le16toh(c.symbol_id);
+    if (len + sizeof(Header) != frame_size(type) + sizeof(CompactHeader) ||
+        symbol >= SEQUENCE_SLOTS || last_sequence[symbol] == 0) {
+        return false;
+    }
+
+    std::memset(&out, 0, sizeof(out));
+    out.type         = type;
+    out.symbol_id    = symbol;
+    out.sequence     = last_sequence[symbol] +
+                       static_cast<int16_t>(le16toh(static_cast<uint16_t>(c.sequence_delta)));
+    out.timestamp_ns = base_ns +
+                       static_cast<int32_t>(le32toh(static_cast<uint32_t>(c.timestamp_delta)));
+    last_sequence[symbol] = out.sequence;
+    decode_body(type, frame + sizeof(CompactHeader), out);
+    return true;
+}
+
+} // namespace v2
+
 #endif
 
@@ -0,0 +1,79 @@
+#ifndef CONFLATION_TABLE_HPP
+#define CONFLATION_TABLE_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "ConfigManager.hpp"
+#include "wire_slab.hpp"
+
+// What a slow client has not been sent while it is conflated: per symbol,
+// the latest quote (already encoded for the client's protocol version)
+// and the range of sequence numbers that were withheld. Trades and depth
+// updates are only counted in that range. Network thread only.
+class ConflationTable {
+public:
+    struct Entry {
+        WireRef quote{nullptr, 0, 0};   // latest withheld quote, retained
+        uint64_t quote_sequence{0};
+        uint64_t first_skipped{0};      // 0 = symbol untouched
+        uint64_t last_skipped{0};
+    };
+
+    ConflationTable() = default;
+    ConflationTable(const ConflationTable&) = delete;
+    ConflationTable& operator=(const ConflationTable&) = delete;
+
+    ~ConflationTable() { clear(); }
+
+    // Withholds one message; a quote replaces the symbol's previous quote
+    void absorb(uint16_t symbol, uint64_t sequence, bool is_quote, const WireRef& ref) {
+        Entry& e = m_entries[symbol];
+        if (e.first_skipped == 0) {
+            e.first_skipped = sequence;
+            m_dirty.push_back(symbol);
+        }
+        e.last_skipped = sequence;
+        if (is_quote) {
+            SlabPool::retain(ref);
+            if (e.quote.slab != nullptr) {
+                SlabPool::release(e.quote.slab);
+            }
+            e.quote = ref;
+            e.quote_sequence = sequence;
+        }
+        ++m_absorbed;
+    }
+
+    // fn(symbol, const Entry&) for every touched symbol in the order they
+    // were first touched, then forgets them
+    template <typename Fn>
+    void drain(Fn&& fn) {
+        for (uint16_t symbol : m_dirty) {
+            fn(symbol, static_cast<const Entry&>(m_entries[symbol]));
+        }
+        clear();
+    }
+
+    bool empty() const { return m_dirty.empty(); }
+    size_t symbols() const { return m_dirty.size(); }
+    uint64_t absorbed() const { return m_absorbed; }   // messages withheld over the table's life
+
+private:
+    void clear() {
+        for (uint16_t symbol : m_dirty) {
+            Entry& e = m_entries[symbol];
+            if (e.quote.slab != nullptr) {
+                SlabPool::release(e.quote.slab);
+            }
+            e = Entry{};
+        }
+        m_dirty.clear();
+    }
+
+    std::array<Entry, MAX_SYMBOL_ID + 1> m_entries{};
+    std::vector<uint16_t> m_dirty;
+    uint64_t m_absorbed{0};
+};
+
+#endif
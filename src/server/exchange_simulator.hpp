@@ -21,6 +21,23 @@
 #include <unordered_map>
 #include <signal.h>
 #include "../common/protocol.hpp"
+#include "outbound_buffer.hpp"
+#include "wire_slab.hpp"
+#include "subscription_index.hpp"
+#include "top_of_book.hpp"
+#include <bitset>
+#include "spsc_queue.hpp"
+#include "gbm_kernel.hpp"
+#include "retransmit_store.hpp"
+#include "multicast_publisher.hpp"
+#include "tsc_clock.hpp"
+#include "pacing_stats.hpp"
+#include "load_profile.hpp"
+#include "fault_injector.hpp"
+#include "conflation_table.hpp"
+#include <sstream>
+#include <thread>
+#include <pthread.h>
 
 
 // enum class MessageType : uint8_t {
@@ -28,19 +45,6 @@
 //     TRADE
 // };
 
-static inline uint64_t htond(double d) {
-    uint64_t x;
-    std::memcpy(&x, &d, sizeof(x));
-    return htobe64(x);
-}
-
-static inline double ntohd(uint64_t x) {
-    x = be64toh(x);
-    double d;
-    std::memcpy(&d, &x, sizeof(d));
-    return d;
-}
-
 // static ExchangeSimulator* g_simulator = nullptr;
 
 // static void signal_handler(int sig) {
@@ -124,11 +128,10 @@ static inline double ntohd(uint64_t x) {
 struct ServerMarketMessage {
     MarketMessage wire;  // PURE protocol struct
 
-    inline static std::atomic<uint64_t> global_sequence{0};
-
-    void assignSequence() {
-        wire.sequence =
-            global_sequence.fetch_add(1, std::memory_order_relaxed) + 1;
+    // Sequence numbers are per symbol. Only the worker that owns the symbol
+    // writes its counter, so no atomic is needed.
+    void assignSequence(uint64_t& symbolSequence) {
+        wire.sequence = ++symbolSequence;
     }
 
     void print_quote() const {
@@ -138,41 +141,90 @@ struct ServerMarketMessage {
 };
 
 struct ClientState {
+    int fd{-1};
+    int slot{-1};   // bit position in the SubscriptionIndex
+    uint8_t wire_version{PROTOCOL_VERSION_1};   // negotiated by OPCODE_SUBSCRIBE_V2
+    bool batch_frames{false};                   // SUBSCRIBE_FLAG_BATCH on a v2 feed
+    bool multicast{false};                      // SUBSCRIBE_FLAG_MULTICAST: data goes to the group, TCP is control only
+    bool snapshots{false};                      // SUBSCRIBE_FLAG_SNAPSHOT: top of book for each new symbol
     std::vector<uint8_t> recv_buffer;
-    std::unordered_set<uint16_t> subscriptions;
+    std::bitset<MAX_SYMBOL_ID + 1> subscriptions;
+    OutboundBuffer send_buffer;
+    ClientFaults faults;   // FAULTS.ENABLED only
+
+    // Slow consumer: above the high water mark the client only gets the
+    // latest quote per symbol, released once it drains to the low water mark
+    bool conflating{false};
+    uint64_t conflating_since_ns{0};
+    ConflationTable conflated;
+
+    // Batch being filled until the next flush; its header goes into the
+    // send_buffer slot reserved ahead of the first message
+    struct OpenBatch {
+        uint64_t header_slot{0};
+        uint32_t count{0};
+        uint32_t bytes{0};
+        uint64_t base_timestamp_ns{0};   // the first frame's
+    } batch;
+    // Last sequence per symbol sent in a batch, for compact frames' deltas
+    std::array<uint64_t, v2::SEQUENCE_SLOTS> last_sequence{};
 };
 
-// std::unordered_map<int, ClientState> m_client_states;
-;
-
-
-struct SymbolData{
-    uint16_t st_symbolID;
+// Compact frames encoded during one broadcast. Subscribers that got the same
+// previous tick of the symbol, in batches with the same base timestamp, get
+// identical bytes: they share one slab copy instead of one each. Holds a
+// reference on each copy until the broadcast is done.
+struct CompactShare {
+    static constexpr int WAYS = 4;
+
+    struct Entry {
+        uint64_t previous;
+        uint64_t base_ns;
+        WireRef ref;
+    };
+    Entry entries[WAYS];
+    int count{0};
+
+    CompactShare() = default;
+    CompactShare(const CompactShare&) = delete;
+    CompactShare& operator=(const CompactShare&) = delete;
+    ~CompactShare() {
+        for (int i = 0; i < count; ++i) {
+            SlabPool::release(entries[i].ref.slab);
+        }
+    }
 
-    double st_symbolPrice;
-    double st_bidPrice;
-    double st_askPrice;
+    const WireRef* find(uint64_t previous, uint64_t base_ns) const {
+        for (int i = 0; i < count; ++i) {
+            if (entries[i].previous == previous && entries[i].base_ns == base_ns) {
+                return &entries[i].ref;
+            }
+        }
+        return nullptr;
+    }
 
-    double st_symbolMU;      //drift
-    double st_symbolSIGMA;   //volatility
-    double st_symbolSpread;  // spread in percent
-    
+    void add(uint64_t previous, uint64_t base_ns, const WireRef& ref) {
+        if (count < WAYS) {
+            SlabPool::retain(ref);
+            entries[count++] = Entry{previous, base_ns, ref};
+        }
+    }
+};
 
-    uint64_t st_symbolSequenceNumber;    //to be decided whether to use it as a atomic<TYPE> or keep it 
-    uint64_t st_timeStamp;
+// Connection on the recovery port: retransmit requests in, replays out
+struct RecoveryClient {
+    std::vector<uint8_t> recv_buffer;
+    OutboundBuffer send_buffer;
+};
 
-    std::mt19937_64 st_rng;
+// Connection on the control port: newline terminated text commands
+struct ControlClient {
+    std::string recv_buffer;
+};
 
-    void printInfo(){
-        std::cout<<"-------------------------------------------------------------------------------\n";
-        std::cout<<"st_symbolID : "<<st_symbolID<<"\nst_symbolPrice : "<<st_symbolPrice<<" ,st_bidPrice : "<<st_bidPrice
-        <<" ,st_askPrice : "<<st_askPrice<<" ,st_symbolMU : "<<st_symbolMU<<" ,st_symbolSIGMA : "<<st_symbolSIGMA
-        <<" ,st_symbolSpread : "<<st_symbolSpread<<" ,st_symbolSequenceNumber : "<<st_symbolSequenceNumber
-        <<" ,st_timeStamp : "<<st_timeStamp<<"\n";
-        // std::cout<<"--------------------------------------------------------------------------------\n";
-    }
+// std::unordered_map<int, ClientState> m_client_states;
+;
 
-};
 
 uint64_t GetTime_ns()
 {
@@ -181,6 +233,46 @@ uint64_t GetTime_ns()
     ).count();
 }
 
+// Pins the calling thread; core < 0 leaves it to the scheduler
+inline void PinThreadToCore(int core){
+    if (core < 0) {
+        return;
+    }
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core, &cpuset);  // choose core ID (0-based)
+
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    if (rc != 0) {
+        errno = rc;
+        perror("pthread_setaffinity_np");
+    }
+}
+
+// One tick generator thread and the disjoint slice of symbols it owns.
+// Only the owning worker touches the SymbolStore entries of its symbols, and every
+// message for a symbol goes through the same FIFO queue, so per-symbol
+// ordering is preserved all the way to the network thread.
+struct TickShard {
+    static constexpr size_t QUEUE_CAPACITY = 1 << 16;
+
+    std::vector<uint16_t> symbols;
+    std::mt19937_64 scheduler_rng;
+    std::atomic<uint64_t> tick_interval_ns{0};   // rewritten by set_tick_rate() at runtime
+    uint64_t last_tick_ns{0};
+    int core{-1};
+    uint64_t now_ns{0};         // timestamp for the burst being generated
+
+    TscClock clock;             // SERVER.LOOPMODE = SPIN only
+    PacingStats pacing;         // lateness of every tick against its slot
+
+    SpscQueue<MarketMessage> queue{QUEUE_CAPACITY};   // worker -> network thread
+    std::thread thread;
+
+    uint16_t burst_ids[TickBurst::MAX_TICKS];
+    TickBurst burst;
+};
+
 class ExchangeSimulator{
     public:
     ExchangeSimulator(uint16_t port, size_t symbols = 100):m_port(port),m_activeSymbolCounts(symbols){
@@ -196,10 +288,48 @@ class ExchangeSimulator{
         // Seed scheduler RNG
         m_scheduler_rng.seed(cfg->m_seed ^ 0xABCDEF);
         m_ticks_per_second = cfg->m_ticksRate;
+        m_control_port     = static_cast<uint16_t>(cfg->m_controlPort);
+        LoadProfile::parse_shape(cfg->m_loadProfile, m_profile.shape);
+        m_profile.base_rate        = cfg->m_ticksRate;
+        m_profile.rate_min         = cfg->m_tickRateMin;
+        m_profile.rate_max         = cfg->m_tickRateMax;
+        m_profile.rate_peak        = cfg->m_tickRatePeak;
+        m_profile.period_ns        = static_cast<uint64_t>(cfg->m_profilePeriodSec * 1e9);
+        m_profile.steps            = cfg->m_profileSteps;
+        m_profile.burst_multiplier = cfg->m_burstMultiplier;
+        m_profile.burst_ns         = static_cast<uint64_t>(cfg->m_burstDurationMs) * 1'000'000ULL;
         m_dt = cfg->m_dt;
         m_bind_IP = cfg->m_ipadd;
 
         m_port = cfg->m_port;
+
+        m_max_batch_bytes    = cfg->m_maxBatchBytes;
+        m_max_batch_delay_ns = static_cast<uint64_t>(cfg->m_maxBatchDelayUs) * 1'000ULL;
+        m_client_queue_bytes  = cfg->m_clientQueueBytes;
+        m_conflate_high_water = cfg->m_conflateHighWater;
+        m_conflate_low_water  = cfg->m_conflateLowWater;
+        m_conflate_max_ns     = static_cast<uint64_t>(cfg->m_conflateMaxMs) * 1'000'000ULL;
+        m_network_core       = cfg->m_networkCore;
+        m_scalar_kernel      = cfg->m_scalarKernel;
+        m_depth_levels       = cfg->m_depthLevels;
+        m_spin_loop          = cfg->m_spinLoop;
+        m_recovery_port      = static_cast<uint16_t>(cfg->m_recoveryPort);
+        m_retransmit         = std::make_unique<RetransmitStore>(cfg->m_recoveryDepth);
+        m_multicast_enabled  = cfg->m_multicastEnabled;
+        m_multicast_group    = cfg->m_multicastGroup;
+        m_multicast_port     = static_cast<uint16_t>(cfg->m_multicastPort);
+        m_multicast_iface    = cfg->m_multicastInterface;
+        m_multicast_ttl      = cfg->m_multicastTTL;
+        if (cfg->m_faultsEnabled) {
+            FaultConfig faults;
+            faults.drop      = cfg->m_faultDrop;
+            faults.duplicate = cfg->m_faultDuplicate;
+            faults.reorder   = cfg->m_faultReorder;
+            faults.corrupt   = cfg->m_faultCorrupt;
+            faults.split     = cfg->m_faultSplit;
+            faults.throttle_bytes_per_sec = static_cast<uint64_t>(cfg->m_faultThrottleKBps) * 1024;
+            enable_fault_injection(faults, cfg->m_seed);
+        }
         // Prepare uniform distribution ONCE
         m_symbol_dist = std::uniform_int_distribution<size_t>(0, m_activeSymbols.size() - 1);
 
@@ -222,36 +352,68 @@ class ExchangeSimulator{
         std::shuffle(allIds.begin(), allIds.end(), rng);
 
         m_activeSymbols.assign(allIds.begin(),allIds.begin() + m_activeSymbolCounts);
-        //Now Generate The Random Parameterised SymbolData for every symbol
+        //Now Generate The Random Parameterised SymbolStore entry for every symbol
+        m_symbolState.SetSeed(cfg->m_seed);
         for (uint16_t symbolId : m_activeSymbols) {
-            m_symbolState[symbolId] = GenerateSymbol(symbolId, cfg);
+            GenerateSymbol(symbolId, cfg);
         }
 
+        BuildShards(cfg);
+    }
+
+    // Splits the active symbols round-robin over SERVER.THREADS workers.
+    // Each shard gets a share of TICKSRATE proportional to its symbol count.
+    void BuildShards(const std::unique_ptr<ConfigManager>& cfg){
+        m_shards.clear();
+        // Nothing to shard (and nothing to divide the rate by); start() refuses to run
+        if (m_activeSymbols.empty()) {
+            std::cerr<<"No active symbols, no tick shards\n";
+            return;
+        }
+        size_t numShards = static_cast<size_t>(std::max(1, cfg->m_numOfThreads));
+        numShards = std::min(numShards, m_activeSymbols.size());
+
+        for (size_t i = 0; i < numShards; ++i) {
+            auto shard = std::make_unique<TickShard>();
+            shard->scheduler_rng.seed(cfg->m_seed ^ 0xABCDEF ^ i);
+            if (!cfg->m_workerCores.empty()) {
+                shard->core = cfg->m_workerCores[i % cfg->m_workerCores.size()];
+            }
+            m_shards.push_back(std::move(shard));
+        }
+
+        for (size_t i = 0; i < m_activeSymbols.size(); ++i) {
+            m_shards[i % numShards]->symbols.push_back(m_activeSymbols[i]);
+        }
+
+        ApplyShardRates();
+        std::cout<<"Tick Shards : "<<m_shards.size()<<"\n";
+    }
+
+    // Each shard gets a share of m_ticks_per_second proportional to its symbol count
+    void ApplyShardRates(){
+        for (auto& shard : m_shards) {
+            shard->tick_interval_ns.store(
+                (1'000'000'000ULL * m_activeSymbols.size()) /
+                (static_cast<uint64_t>(m_ticks_per_second) * shard->symbols.size()),
+                std::memory_order_relaxed);
+        }
     }
 
     void printSymbolData(){
         for(auto symbolid: m_activeSymbols){
-            auto temp = m_symbolState[symbolid];
-            temp.printInfo();
+            m_symbolState.PrintInfo(symbolid);
         }
     }
     //start accepting connections 
     //So create a single instance of the epoll which the clients are going to connect
     void start(){
-        // ---- PIN THREAD TO A CORE ----
-        cpu_set_t cpuset;
-        CPU_ZERO(&cpuset);
-        CPU_SET(2, &cpuset);  // choose core ID (0-based)
-
-        int rc = pthread_setaffinity_np(
-            pthread_self(),
-            sizeof(cpu_set_t),
-            &cpuset
-        );
-
-        if (rc != 0) {
-            perror("pthread_setaffinity_np");
+        if (m_shards.empty()) {
+            std::cerr<<"No active symbols to simulate\n";
+            return;
         }
+        // ---- PIN NETWORK THREAD TO A CORE ----
+        PinThreadToCore(m_network_core);
         s_instance = this;
 
         signal(SIGINT,  ExchangeSimulator::SignalHandler);
@@ -322,14 +484,79 @@ class ExchangeSimulator{
         }
 
 
+        if (m_recovery_port != 0 && !OpenRecoveryListener()) {
+            close(m_listen_fd);
+            close(m_epollFD);
+            return;
+        }
+
+        if (m_multicast_enabled &&
+            !m_multicast.open(m_multicast_group, m_multicast_port, m_multicast_iface, m_multicast_ttl)) {
+            if (m_recovery_listen_fd >= 0) close(m_recovery_listen_fd);
+            close(m_listen_fd);
+            close(m_epollFD);
+            return;
+        }
+
+        if (m_control_port != 0 && !OpenControlListener()) {
+            if (m_recovery_listen_fd >= 0) close(m_recovery_listen_fd);
+            m_multicast.close();
+            close(m_listen_fd);
+            close(m_epollFD);
+            return;
+        }
+
+        if (m_spin_loop) {
+            m_clock.calibrate();
+            // Spinning threads sharing a core starve each other
+            if (std::thread::hardware_concurrency() < m_shards.size() + 1) {
+                std::cerr << "LOOPMODE = SPIN with " << m_shards.size() + 1 << " spinning threads on "
+                          << std::thread::hardware_concurrency() << " cores: expect worse pacing than BLOCK\n";
+            }
+        }
         m_last_tick_ns = GetTime_ns();
         m_running = true;
 
         m_start_time_ns = GetTime_ns();
         m_end_time_ns   = m_start_time_ns + m_runDurationSec * 1'000'000'000ULL;
+        m_profile_start_ns = m_start_time_ns;
+        m_profile_next_ns  = m_start_time_ns;
+        set_tick_rate(m_profile.rate_at(0));
+
+        StartWorkers();
         run();
+        StopWorkers();
+        ReportPacing();
+
+        if (m_snapshots_sent != 0) {
+            std::cout << "Snapshots sent: " << m_snapshots_sent << "\n";
+        }
+        if (m_conflate_high_water != 0) {
+            std::cout << "Slow consumers: conflated " << m_conflation_episodes
+                      << " times, " << m_conflated_messages << " messages withheld, "
+                      << m_conflation_timeouts << " disconnected still conflated\n";
+        }
+        if (m_faults.enabled()) {
+            std::cout << "Faults injected: dropped " << m_faults.dropped()
+                      << " duplicated " << m_faults.duplicated()
+                      << " reordered " << m_faults.reordered()
+                      << " corrupted " << m_faults.corrupted()
+                      << " split sends " << m_faults.split()
+                      << " throttled sends " << m_faults.throttled() << "\n";
+        }
         for (int fd : clients) close(fd);
         clients.clear();
+        for (auto& [fd, rc] : m_recovery_clients) close(fd);
+        m_recovery_clients.clear();
+        if (m_recovery_listen_fd >= 0) close(m_recovery_listen_fd);
+        for (auto& [fd, cc] : m_control_clients) close(fd);
+        m_control_clients.clear();
+        if (m_control_listen_fd >= 0) close(m_control_listen_fd);
+        if (m_multicast.is_open()) {
+            std::cout << "Multicast datagrams sent: " << m_multicast.packets_sent()
+                      << " dropped: " << m_multicast.packets_dropped() << "\n";
+            m_multicast.close();
+        }
         close(m_epollFD);
         close(m_listen_fd);
     }
@@ -343,12 +570,18 @@ class ExchangeSimulator{
         while (m_running && !m_shutdown_requested.load(std::memory_order_relaxed)) {
 
 
-            if (GetTime_ns() >= m_end_time_ns) {
+            const uint64_t now = m_spin_loop ? m_clock.now_ns() : GetTime_ns();
+            if (now >= m_end_time_ns) {
                 m_running = false;
                 break;
             }
-            // int n = epoll_wait(m_epollFD, events, MAX_EVENTS, 0);
-            int timeout_ms = std::max<int>(1, m_tick_interval_ns / 1'000'000);
+            if (now >= m_profile_next_ns) {
+                m_profile_next_ns = now + PROFILE_UPDATE_NS;
+                set_tick_rate(m_profile.rate_at(now - m_profile_start_ns));
+                expire_conflated_clients();
+            }
+            // Spin mode never sleeps in the kernel
+            int timeout_ms = m_spin_loop ? 0 : std::max<int>(1, m_tick_interval_ns / 1'000'000);
             int n = epoll_wait(m_epollFD, events, MAX_EVENTS, timeout_ms);
 
             for(int i=0;i<n;i++){
@@ -356,259 +589,915 @@ class ExchangeSimulator{
                 if(temp_fd==m_listen_fd){
                     handle_new_connection();
                 }
+                else if(temp_fd==m_recovery_listen_fd){
+                    handle_new_recovery_connection();
+                }
+                else if(temp_fd==m_control_listen_fd){
+                    handle_new_control_connection();
+                }
+                else if(m_control_clients.count(temp_fd)){
+                    if(events[i].events &(EPOLLHUP | EPOLLERR)){
+                        close_control_client(temp_fd);
+                    }
+                    else if (events[i].events & EPOLLIN) {
+                        handle_control_read(temp_fd);
+                    }
+                }
+                else if(m_recovery_clients.count(temp_fd)){
+                    if(events[i].events &(EPOLLHUP | EPOLLERR)){
+                        close_recovery_client(temp_fd);
+                    }
+                    else if (events[i].events & EPOLLIN) {
+                        handle_recovery_read(temp_fd);
+                    }
+                }
                 else if(events[i].events &(EPOLLHUP | EPOLLERR)){
                     handle_client_disconnect(temp_fd);
                     std::cerr << "Client disconnected fd=" << temp_fd << "\n";
                 }
-                else if (events[i].events & EPOLLIN) {
-                    handle_client_read(temp_fd);
+                else {
+                    if (events[i].events & EPOLLIN) {
+                        handle_client_read(temp_fd);
+                    }
+                    if (events[i].events & EPOLLOUT) {
+                        handle_client_writable(temp_fd);
+                    }
                 }
 
             }
-            //TICKS GENERATION
-            uint64_t time_now = GetTime_ns();
-
             if (m_shutdown_requested.load(std::memory_order_relaxed)) {
                 break;
             }
 
-            while(time_now-m_last_tick_ns>=m_tick_interval_ns){
-                // m_last_tick_ns=time_now;
-                m_last_tick_ns += m_tick_interval_ns;
-                uint16_t symbolID = PickSymbol();
-                generate_ticks(symbolID);
-            }
+            //TICKS FROM THE GENERATOR SHARDS
+            DrainShards();
+
+            // One flush per client per epoll iteration
+            flush_clients();
         }
 
     }
+    // Network thread (or before start()): retargets every worker. Workers
+    // pick the new interval up on their next loop iteration; ticks already
+    // due are still emitted. Clamped to [RATEMIN, RATEPEAK]: the profile
+    // keeps its shape inside RATEMAX, only bursts and spikes go above.
     void set_tick_rate(uint32_t ticksPerSeconds){
+        ticksPerSeconds = std::clamp(ticksPerSeconds, m_profile.rate_min,
+                                     std::max(m_profile.rate_peak, m_profile.rate_max));
+        if (ticksPerSeconds == m_ticks_per_second) {
+            return;
+        }
+        m_ticks_per_second = ticksPerSeconds;
+        m_tick_interval_ns = 1'000'000'000ULL / m_ticks_per_second;
+        ApplyShardRates();
+    }
 
+    // Applies to every TCP client from its next message on; the multicast
+    // group and the recovery port are never faulted
+    void enable_fault_injection(const FaultConfig& faults, uint64_t seed){
+        m_faults.enable(faults, seed ^ 0xFA017);
+        const uint64_t now = GetTime_ns();
+        for (auto& [fd, state] : m_client_states) {
+            m_faults.attach(state.faults, state.slot, now);
+        }
     }
 
-    void enable_fault_injection(){
+    private:
+    void StartWorkers(){
+        m_workers_stop.store(false, std::memory_order_relaxed);
+        const uint64_t now = GetTime_ns();
+        for (auto& shard : m_shards) {
+            shard->last_tick_ns = now;
+            shard->thread = std::thread([this, s = shard.get()] { WorkerLoop(*s); });
+        }
+    }
 
+    void StopWorkers(){
+        m_workers_stop.store(true, std::memory_order_relaxed);
+        for (auto& shard : m_shards) {
+            if (shard->thread.joinable()) {
+                shard->thread.join();
+            }
+        }
     }
 
-    private:
-    uint16_t PickSymbol(){
-        assert(!m_activeSymbols.empty());
+    // Tick generator: catch up on every tick that is due in bursts of up to
+    // TickBurst::MAX_TICKS, then sleep until the next one. In spin mode the
+    // worker polls a TSC clock instead of sleeping, so ticks leave one at a
+    // time close to their slot. Either way the lateness of each tick is
+    // recorded in shard.pacing.
+    void WorkerLoop(TickShard& shard){
+        PinThreadToCore(shard.core);
+        if (m_spin_loop) {
+            shard.clock.calibrate();
+            shard.last_tick_ns = shard.clock.now_ns();
+        }
 
-        std::uniform_int_distribution<size_t> dist(
-            0, m_activeSymbols.size() - 1
-        );
+        while (!m_workers_stop.load(std::memory_order_relaxed)) {
+            uint64_t time_now = m_spin_loop ? shard.clock.now_ns() : GetTime_ns();
+            const uint64_t interval = shard.tick_interval_ns.load(std::memory_order_relaxed);
+
+            while(time_now-shard.last_tick_ns>=interval){
+                size_t n = 0;
+                while (n < TickBurst::MAX_TICKS &&
+                       time_now - shard.last_tick_ns >= interval) {
+                    shard.last_tick_ns += interval;
+                    shard.pacing.record(time_now - shard.last_tick_ns);
+                    shard.burst_ids[n++] = PickSymbol(shard);
+                }
+                shard.now_ns = time_now;
+                generate_ticks(shard, n);
+            }
 
-        size_t idx = dist(m_scheduler_rng);
-        return m_activeSymbols[idx];
+            if (m_spin_loop) {
+                TscClock::relax();
+                continue;
+            }
+            uint64_t wait_ns = interval - (time_now - shard.last_tick_ns);
+            std::this_thread::sleep_for(std::chrono::nanoseconds(std::min<uint64_t>(wait_ns, 1'000'000)));
+        }
     }
 
-    
-    // void generate_ticks(uint16_t symbolId){
-    //     SymbolData& tempSymbolData= m_symbolState[symbolId];
-    //     static thread_local std::normal_distribution<double> normal(0.0, 1.0);
-    //     /*Geometric Brownian Motion Tick Generator:*/
-    //     double dW = normal(tempSymbolData.st_rng);
-    //     double dt = m_dt;
-    //     double mu = tempSymbolData.st_symbolMU;
-    //     double sigma = tempSymbolData.st_symbolSIGMA;
-    //     //calculate Symbol Price 
-    //     tempSymbolData.st_symbolPrice *= std::exp((mu - 0.5 * sigma * sigma) * dt + sigma * std::sqrt(dt) * dW);
-
-    //     //Calculate Ask and Bid Component here
-    //     double halfSpread = tempSymbolData.st_symbolSpread *0.5;
-    //     tempSymbolData.st_bidPrice = tempSymbolData.st_symbolPrice * (1.0 - halfSpread);
-    //     tempSymbolData.st_askPrice = tempSymbolData.st_symbolPrice * (1.0 + halfSpread);
-
-    //     tempSymbolData.st_symbolSequenceNumber++;
-    //     tempSymbolData.st_timeStamp = GetTime_ns();
-
-
-    //     MarketMessage msg = build_message(tempSymbolData);
-    //     broadcast_message(&msg, sizeof(msg));
-    // }
+    // Tick lateness over all workers; call after StopWorkers()
+    void ReportPacing(){
+        PacingStats total;
+        bool tsc = false;
+        for (auto& shard : m_shards) {
+            total.merge(shard->pacing);
+            tsc = tsc || shard->clock.uses_tsc();
+        }
+        std::cout << "Tick pacing (" << (m_spin_loop ? (tsc ? "spin, rdtsc" : "spin, steady_clock") : "sleep")
+                  << "): " << total.count() << " ticks, late by"
+                  << " mean " << static_cast<uint64_t>(total.mean()) << " ns"
+                  << " p50 " << total.quantile(0.50) << " ns"
+                  << " p99 " << total.quantile(0.99) << " ns"
+                  << " p99.9 " << total.quantile(0.999) << " ns"
+                  << " max " << total.max() << " ns\n";
+    }
 
-    void generate_ticks(uint16_t symbol_id){
-        SymbolData& tempSymbolData = m_symbolState[symbol_id];
+    // Network thread: hand every queued tick to the broadcast path.
+    // At most one queue's worth per shard so epoll is never starved.
+    void DrainShards(){
+        for (auto& shard : m_shards) {
+            shard->queue.consume(
+                [this](const MarketMessage& msg) { broadcast_message(msg); },
+                TickShard::QUEUE_CAPACITY);
+        }
+    }
 
-        // 1. Evolve price ONCE
-        EvolvePrice(tempSymbolData);
+    // Backpressure: if the network thread falls behind, the worker waits
+    void Publish(TickShard& shard, const MarketMessage& msg){
+        while (!shard.queue.try_push(msg)) {
+            if (m_workers_stop.load(std::memory_order_relaxed)) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
 
-        // 2. Update bid / ask
-        Update_Quote_Prices(tempSymbolData);
+    uint16_t PickSymbol(TickShard& shard){
+        assert(!shard.symbols.empty());
+
+        std::uniform_int_distribution<size_t> dist(
+            0, shard.symbols.size() - 1
+        );
 
-        // 3. Decide message type (70/30)
-        if (Is_Quote_Message()) {
-            BuildAndSendQuote(tempSymbolData);
+        size_t idx = dist(shard.scheduler_rng);
+        return shard.symbols[idx];
+    }
+
+    
+    void generate_ticks(TickShard& shard, size_t n){
+        TickBurst& burst = shard.burst;
+
+        // 1. Evolve prices, bid / ask and draw sizes for the whole burst
+        if (m_scalar_kernel) {
+            gbm::EvolveScalar(m_symbolState, shard.burst_ids, n, burst);
         } else {
-            BuildAndSendTrade(tempSymbolData);
+            gbm::EvolveBatch(m_symbolState, shard.burst_ids, n, burst);
+        }
+
+        // 2. Decide message type (70/30) and publish in tick order
+        for (size_t i = 0; i < burst.count; ++i) {
+            if (Is_Quote_Message(shard)) {
+                BuildAndSendQuote(burst, i, shard);
+                if (m_depth_levels > 1) {
+                    BuildAndSendDepth(burst, i, shard);
+                }
+            } else {
+                BuildAndSendTrade(burst, i, shard);
+            }
         }
     }
-    bool Is_Quote_Message(){
+    bool Is_Quote_Message(TickShard& shard){
         static thread_local std::uniform_real_distribution<double> dist(0.0, 1.0);
-        double r = dist(m_scheduler_rng);
+        double r = dist(shard.scheduler_rng);
         return r < MSGQuoteRatio;  // e.g. 0.70
     }
 
-    void BuildAndSendQuote(SymbolData& temp_symbolData) {
+    void BuildAndSendQuote(const TickBurst& burst, size_t i, TickShard& shard) {
 
         ServerMarketMessage msg{};
         msg.wire.type = MessageType::QUOTE;
-        msg.wire.symbol_id = temp_symbolData.st_symbolID;
+        msg.wire.symbol_id = burst.symbol[i];
         // msg.wire.sequence  = ++temp_symbolData.st_symbolSequenceNumber;
-        msg.wire.timestamp_ns = GetTime_ns();
+        msg.wire.timestamp_ns = shard.now_ns;
+
+        msg.wire.quote.bid_price = burst.bid[i];
+        msg.wire.quote.ask_price = burst.ask[i];
+        msg.wire.quote.bid_qty   = burst.bid_qty[i];
+        msg.wire.quote.ask_qty   = burst.ask_qty[i];
 
-        msg.wire.quote.bid_price = temp_symbolData.st_bidPrice;
-        msg.wire.quote.ask_price = temp_symbolData.st_askPrice;
-        msg.wire.quote.bid_qty   = Random_Quote_Qty(temp_symbolData);
-        msg.wire.quote.ask_qty   = Random_Quote_Qty(temp_symbolData);
+        msg.assignSequence(m_symbolState.sequence[msg.wire.symbol_id]);
 
-        msg.assignSequence();
+        // endian conversion happens once, on the network thread (broadcast_message)
+        Publish(shard, msg.wire);
 
-        uint64_t bp = htond(temp_symbolData.st_bidPrice);
-        uint64_t ap = htond(temp_symbolData.st_askPrice);
-        std::memcpy(&msg.wire.quote.bid_price, &bp, sizeof(bp));
-        std::memcpy(&msg.wire.quote.ask_price, &ap, sizeof(ap));
+    }
 
-        /* endian conversion ON wire */
-        // msg.wire.symbol_id    = htons(msg.wire.symbol_id);
-        // msg.wire.sequence     = htobe64(msg.wire.sequence);
-        // msg.wire.timestamp_ns = htobe64(msg.wire.timestamp_ns);
+    // Multi-level mode: after each quote refresh one deeper level per side.
+    // Levels sit one spread apart behind the top, deeper ones carry more size;
+    // the level index rotates per symbol so each of its levels is refreshed
+    // every DEPTHLEVELS - 1 of its quotes.
+    void BuildAndSendDepth(const TickBurst& burst, size_t i, TickShard& shard) {
+        uint8_t& cursor = m_symbolState.depth_cursor[burst.symbol[i]];
+        const uint32_t level = 1 + cursor;
+        cursor = static_cast<uint8_t>((cursor + 1) % (m_depth_levels - 1));
 
-        broadcast_message(msg.wire);
+        const double step = burst.ask[i] - burst.bid[i];
 
+        ServerMarketMessage msg{};
+        msg.wire.type = MessageType::DEPTH;
+        msg.wire.symbol_id = burst.symbol[i];
+        msg.wire.timestamp_ns = shard.now_ns;
+        msg.wire.depth.level = static_cast<uint8_t>(level);
+
+        msg.wire.depth.side  = BookSide::BID;
+        msg.wire.depth.price = burst.bid[i] - step * level;
+        msg.wire.depth.qty   = burst.bid_qty[i] * (level + 1);
+        msg.assignSequence(m_symbolState.sequence[msg.wire.symbol_id]);
+        Publish(shard, msg.wire);
+
+        msg.wire.depth.side  = BookSide::ASK;
+        msg.wire.depth.price = burst.ask[i] + step * level;
+        msg.wire.depth.qty   = burst.ask_qty[i] * (level + 1);
+        msg.assignSequence(m_symbolState.sequence[msg.wire.symbol_id]);
+        Publish(shard, msg.wire);
     }
 
-    uint32_t Random_Quote_Qty(SymbolData& temp_symbolData){
-        // Log-normal gives realistic size distribution
-        static thread_local std::lognormal_distribution<double> qty_dist(
-            3.5,   // mean (log space)
-            0.8    // stddev
-        );
+    void BuildAndSendTrade(const TickBurst& burst, size_t i, TickShard& shard) {
+        ServerMarketMessage  msg{};
+        msg.wire.type = MessageType::TRADE;
+        msg.wire.symbol_id = burst.symbol[i];
+        // msg.wire.sequence = ++temp_symbolData.st_symbolSequenceNumber;
+        msg.wire.timestamp_ns = shard.now_ns;
+
+        // Trade executes at bid or ask
+        bool aggressor_buy = burst.aggressor_buy[i] != 0;
+        msg.wire.trade.aggressor_buy = aggressor_buy;
+
+        msg.wire.trade.trade_price = aggressor_buy ? burst.ask[i] : burst.bid[i];
 
-        uint32_t qty = static_cast<uint32_t>(qty_dist(temp_symbolData.st_rng));
+        msg.wire.trade.trade_qty = burst.trade_qty[i];
 
-        // Clamp to reasonable bounds
-        if (qty < 10)    qty = 10;
-        if (qty > 10000) qty = 10000;
+        msg.assignSequence(m_symbolState.sequence[msg.wire.symbol_id]);
 
-        return qty;
+        Publish(shard, msg.wire);
     }
 
-    void Update_Quote_Prices(SymbolData& temp_symbolData){
-        double halfSpread = temp_symbolData.st_symbolSpread * 0.5;
+    void broadcast_message(const MarketMessage& msg){
+        // std::cout << "[SERVER] broadcast called, sym="
+        //   << msg.symbol_id << "\n";
+
+        m_top_of_book.on_broadcast(msg);
 
-        temp_symbolData.st_bidPrice = temp_symbolData.st_symbolPrice * (1.0 - halfSpread);
-        temp_symbolData.st_askPrice = temp_symbolData.st_symbolPrice * (1.0 + halfSpread);
+        // The multicast group gets every tick, TCP only what is subscribed
+        const bool multicast = m_multicast.is_open();
+        if (!multicast && !m_subscription_index.has_subscribers(msg.symbol_id)) {
+            return;
+        }
 
-        // Safety invariant
-        if (temp_symbolData.st_bidPrice >= temp_symbolData.st_askPrice) {
-            temp_symbolData.st_bidPrice = temp_symbolData.st_symbolPrice * 0.999;
-            temp_symbolData.st_askPrice = temp_symbolData.st_symbolPrice * 1.001;
+        // Encoded once per protocol version in use into a shared slab, then
+        // referenced by every subscriber of that version
+        const MarketMessage wire = to_wire(msg);
+        // Only ticks somebody received can be missed, so only those are kept
+        m_retransmit->record(msg.symbol_id, msg.sequence, wire);
+
+        uint8_t frame[v2::MAX_FRAME];
+        size_t frame_len = 0;
+        if (multicast) {
+            frame_len = v2::encode(msg, frame);
+            m_multicast.publish(frame, frame_len);
         }
+
+        WireRef refs[PROTOCOL_VERSION_MAX + 1];
+        bool encoded[PROTOCOL_VERSION_MAX + 1] = {};
+        auto ref_for = [&](uint8_t version) -> const WireRef& {
+            if (!encoded[version]) {
+                if (version == PROTOCOL_VERSION_2) {
+                    if (frame_len == 0) {
+                        frame_len = v2::encode(msg, frame);
+                    }
+                    refs[version] = m_slab_pool.store(frame, static_cast<uint32_t>(frame_len));
+                } else {
+                    refs[version] = m_slab_pool.store(&wire, sizeof(wire));
+                }
+                encoded[version] = true;
+            }
+            return refs[version];
+        };
+
+        CompactShare compact;
+        m_subscription_index.for_each_subscriber(msg.symbol_id, [&](int slot) {
+            ClientState& state = *m_slot_clients[slot];
+
+            // Falling behind: conflate rather than queue
+            if (!state.conflating && m_conflate_high_water != 0 &&
+                state.send_buffer.pending() >= m_conflate_high_water) {
+                state.conflating = true;
+                state.conflating_since_ns = GetTime_ns();
+                ++m_conflation_episodes;
+            }
+            if (state.conflating) {
+                const bool quote = msg.type == MessageType::QUOTE;
+                state.conflated.absorb(msg.symbol_id, msg.sequence, quote,
+                                       quote ? ref_for(state.wire_version) : WireRef{nullptr, 0, 0});
+                ++m_conflated_messages;
+                return;
+            }
+
+            // Queue full: the client has stopped draining, drop it
+            const bool queued = m_faults.enabled()
+                ? queue_with_faults(state, ref_for(state.wire_version))
+                : queue_message(state, ref_for(state.wire_version), &compact);
+            if (!queued) {
+                m_dead_clients.push_back(state.fd);
+                return;
+            }
+
+            // Byte budget reached: flush this client now, unless its
+            // socket is full and EPOLLOUT will resume it
+            if (state.send_buffer.pending() >= m_max_batch_bytes && !state.send_buffer.would_block()) {
+                seal_batch(state);
+                if (flush_client(state) < 0) {
+                    m_dead_clients.push_back(state.fd);
+                }
+            }
+        });
+
+        // Latency budget: the oldest pending tick has waited long enough
+        if (m_batch_open_ns == 0) {
+            m_batch_open_ns = msg.timestamp_ns;
+        } else if (msg.timestamp_ns - m_batch_open_ns >= m_max_batch_delay_ns) {
+            flush_clients();
+        }
+
+        reap_dead_clients();
     }
 
-    void EvolvePrice(SymbolData& temp_symbolData){
-        // Normal distribution for Wiener process
-        static thread_local std::normal_distribution<double> normal(0.0, 1.0);
+    // Appends one encoded message to a client's queue, opening a batch
+    // frame first if the client asked for them. In a batch the shared v2
+    // frame is re-encoded compactly for this client where its deltas fit
+    // (see protocol.hpp), or taken from the broadcast's earlier encodings
+    // when another client's deltas were the same. share is null on the
+    // fault path, whose frames may be altered or from another tick. False
+    // if the queue is full.
+    bool queue_message(ClientState& state, const WireRef& ref, CompactShare* share = nullptr){
+        if (!state.batch_frames) {
+            return state.send_buffer.append(ref);
+        }
+        ClientState::OpenBatch& batch = state.batch;
+        if (batch.count == 0) {
+            if (ref.len + sizeof(v2::BatchHeader) > state.send_buffer.free_space()) {
+                return false;
+            }
+            batch.header_slot       = state.send_buffer.reserve();
+            batch.base_timestamp_ns = v2::frame_timestamp(ref.bytes());
+        }
+        WireRef out = ref;
+        v2::Header h;
+        std::memcpy(&h, ref.bytes(), sizeof(h));
+        const uint16_t symbol = le16toh(h.symbol_id);
+        const uint64_t previous = symbol < v2::SEQUENCE_SLOTS ? state.last_sequence[symbol] : 0;
+        const WireRef* shared = share ? share->find(previous, batch.base_timestamp_ns) : nullptr;
+        if (shared != nullptr) {
+            out = *shared;
+            state.last_sequence[symbol] = le64toh(h.sequence);
+        } else {
+            uint8_t compact[v2::MAX_FRAME];
+            const size_t len = v2::encode_batched(ref.bytes(), ref.len, batch.base_timestamp_ns,
+                                                  state.last_sequence.data(), compact);
+            if (len != 0) {
+                out = m_slab_pool.store(compact, static_cast<uint32_t>(len));
+                if (share != nullptr) {
+                    share->add(previous, batch.base_timestamp_ns, out);
+                }
+            }
+        }
+        if (!state.send_buffer.append(out)) {
+            return false;
+        }
+        ++batch.count;
+        batch.bytes += out.len;
+        if (batch.count == v2::MAX_BATCH_COUNT) {
+            seal_batch(state);
+        }
+        return true;
+    }
 
-        double dW = normal(temp_symbolData.st_rng);
+    // queue_message() through the fault layer: the message may be dropped,
+    // doubled, corrupted or held back behind the client's next one
+    bool queue_with_faults(ClientState& state, const WireRef& ref){
+        ClientFaults& faults = state.faults;
+        const uint32_t action = m_faults.decide(faults);
+        if (action & FaultInjector::DROP) {
+            return true;
+        }
 
-        double mu    = temp_symbolData.st_symbolMU;
-        double sigma = temp_symbolData.st_symbolSIGMA;
-        double dt    = m_dt;
+        WireRef out = ref;
+        if (action & FaultInjector::CORRUPT) {
+            uint8_t copy[sizeof(MarketMessage) > v2::MAX_FRAME ? sizeof(MarketMessage) : v2::MAX_FRAME];
+            std::memcpy(copy, ref.bytes(), ref.len);
+            m_faults.corrupt(faults, copy, ref.len);
+            out = m_slab_pool.store(copy, ref.len);
+        }
 
-        // Geometric Brownian Motion
-        temp_symbolData.st_symbolPrice *= std::exp((mu - 0.5 * sigma * sigma) * dt + sigma * std::sqrt(dt) * dW);
+        if (action & FaultInjector::REORDER) {
+            SlabPool::retain(out);
+            faults.held = out;
+            return true;
+        }
 
-        // Safety guard (prices should never go negative)
-        if (temp_symbolData.st_symbolPrice < 0.01) {
-            temp_symbolData.st_symbolPrice = 0.01;
+        if (!queue_message(state, out)) {
+            return false;
+        }
+        if ((action & FaultInjector::DUPLICATE) && !queue_message(state, out)) {
+            return false;
         }
+        if (faults.holding()) {
+            const bool ok = queue_message(state, faults.held);
+            faults.release_held();
+            return ok;
+        }
+        return true;
     }
 
-    void BuildAndSendTrade(SymbolData& temp_symbolData) {
-        ServerMarketMessage  msg{};
-        msg.wire.type = MessageType::TRADE;
-        msg.wire.symbol_id = temp_symbolData.st_symbolID;
-        // msg.wire.sequence = ++temp_symbolData.st_symbolSequenceNumber;
-        msg.wire.timestamp_ns = GetTime_ns();
+    // One sendmsg() for this client, cut short by split / throttle faults.
+    // A conflated client that has drained to the low water mark gets its
+    // withheld quotes and goes back to the full feed.
+    ssize_t flush_client(ClientState& state){
+        ssize_t sent;
+        if (!m_faults.enabled()) {
+            sent = state.send_buffer.flush(state.fd);
+        } else {
+            const size_t limit = m_faults.flush_limit(state.faults, state.send_buffer.pending(), GetTime_ns());
+            sent = state.send_buffer.flush(state.fd, limit);
+            if (sent > 0) {
+                m_faults.on_sent(state.faults, static_cast<size_t>(sent));
+            }
+        }
+        if (sent >= 0 && state.conflating && state.send_buffer.pending() <= m_conflate_low_water &&
+            !release_conflated(state)) {
+            return -1;
+        }
+        return sent;
+    }
 
-        // Trade executes at bid or ask
-        bool aggressor_buy = Random_Bool(temp_symbolData);
-        msg.wire.trade.aggressor_buy = aggressor_buy;
+    // A client conflated for longer than CONFLATE_MAX_MS is not catching up:
+    // it only ever sees a fraction of the feed, so drop it like one whose
+    // queue overflowed. Checked with the profile update, every 10 ms.
+    void expire_conflated_clients(){
+        if (m_conflate_max_ns == 0) {
+            return;
+        }
+        const uint64_t now = GetTime_ns();
+        for (auto& [fd, state] : m_client_states) {
+            if (state.conflating && now - state.conflating_since_ns > m_conflate_max_ns) {
+                std::cout << "Client " << fd << " conflated for over "
+                          << m_conflate_max_ns / 1'000'000 << " ms, disconnecting\n";
+                ++m_conflation_timeouts;
+                m_dead_clients.push_back(fd);
+            }
+        }
+        reap_dead_clients();
+    }
 
-        msg.wire.trade.trade_price = aggressor_buy ? temp_symbolData.st_askPrice : temp_symbolData.st_bidPrice;
+    // Per withheld symbol: GAP_FILL up to the latest quote, the quote, and
+    // a GAP_FILL for anything withheld after it, so the feed handler skips
+    // the withheld sequences instead of requesting them. False if the
+    // client's queue cannot take it.
+    bool release_conflated(ClientState& state){
+        state.conflating = false;
+        bool fits = true;
+        state.conflated.drain([&](uint16_t symbol, const ConflationTable::Entry& e) {
+            if (!state.subscriptions.test(symbol)) {
+                return;   // unsubscribed while conflated
+            }
+            if (e.quote.slab != nullptr) {
+                if (e.first_skipped < e.quote_sequence) {
+                    fits = fits && queue_gap_fill(state, symbol, e.quote_sequence - 1);
+                }
+                fits = fits && queue_message(state, e.quote);
+            }
+            if (e.last_skipped > e.quote_sequence) {
+                fits = fits && queue_gap_fill(state, symbol, e.last_skipped);
+            }
+        });
+        return fits;
+    }
 
-        msg.wire.trade.trade_qty = Random_Trade_Qty(temp_symbolData);
+    // Top of book of each symbol the client just subscribed to, flushed at
+    // once. Queued ahead of any live tick for those symbols, so the client's
+    // stream continues at the snapshot's sequence + 1. Bypasses fault
+    // injection and the retransmit store: a snapshot has no sequence of its own.
+    bool send_snapshots(ClientState& state, const std::bitset<MAX_SYMBOL_ID + 1>& symbols){
+        if (symbols.none()) {
+            return true;
+        }
+        for (uint16_t sym = MIN_SYMBOL_ID; sym <= MAX_SYMBOL_ID; ++sym) {
+            MarketMessage snap;
+            if (!symbols.test(sym) || !m_top_of_book.snapshot(sym, snap)) {
+                continue;
+            }
+            bool queued;
+            if (state.wire_version == PROTOCOL_VERSION_2) {
+                uint8_t frame[v2::MAX_FRAME];
+                const size_t len = v2::encode(snap, frame);
+                queued = queue_message(state, m_slab_pool.store(frame, static_cast<uint32_t>(len)));
+            } else {
+                const MarketMessage wire = to_wire(snap);
+                queued = queue_message(state, m_slab_pool.store(&wire, sizeof(wire)));
+            }
+            if (!queued) {
+                return false;
+            }
+            ++m_snapshots_sent;
+        }
+        seal_batch(state);
+        return state.send_buffer.would_block() || flush_client(state) >= 0;
+    }
 
-        msg.assignSequence();
+    bool queue_gap_fill(ClientState& state, uint16_t symbol, uint64_t through){
+        MarketMessage gap{};
+        gap.type = MessageType::GAP_FILL;
+        gap.symbol_id = symbol;
+        gap.sequence = through;
+        gap.timestamp_ns = GetTime_ns();
+        if (state.wire_version == PROTOCOL_VERSION_2) {
+            uint8_t frame[v2::MAX_FRAME];
+            const size_t len = v2::encode(gap, frame);
+            return queue_message(state, m_slab_pool.store(frame, static_cast<uint32_t>(len)));
+        }
+        const MarketMessage wire = to_wire(gap);
+        return queue_message(state, m_slab_pool.store(&wire, sizeof(wire)));
+    }
 
-        // msg.wire.symbol_id    = htons(msg.wire.symbol_id);
-        // msg.wire.sequence     = htobe64(msg.wire.sequence);
-        // msg.wire.timestamp_ns = htobe64(msg.wire.timestamp_ns);
+    // EPOLLOUT: the socket has room again after a short write
+    void handle_client_writable(int client_fd){
+        auto it = m_client_states.find(client_fd);
+        if (it == m_client_states.end() || !it->second.send_buffer.would_block()) {
+            return;
+        }
+        if (flush_client(it->second) < 0) {
+            m_dead_clients.push_back(client_fd);
+        }
+        reap_dead_clients();
+    }
 
-        broadcast_message(msg.wire);
+    // Writes the header of the client's open batch, stamped with the send time
+    void seal_batch(ClientState& state){
+        ClientState::OpenBatch& batch = state.batch;
+        if (batch.count == 0) {
+            return;
+        }
+        const v2::BatchHeader header = v2::make_batch_header(
+            static_cast<uint16_t>(batch.count), batch.bytes, batch.base_timestamp_ns, GetTime_ns());
+        state.send_buffer.fill(batch.header_slot, m_slab_pool.store(&header, sizeof(header)));
+        batch.count = 0;
+        batch.bytes = 0;
     }
 
-    bool Random_Bool(SymbolData& s){
-        static thread_local std::bernoulli_distribution dist(0.5);
-        return dist(s.st_rng);
+    // Pushes every client's pending bytes in one sendmsg() each, closing
+    // the open batch frame first: one frame per client per flush.
+    // Short writes and EAGAIN leave the remainder queued for the next pass.
+    void flush_clients(){
+        if (m_multicast.is_open()) {
+            m_multicast.flush();
+        }
+        for (auto& [fd, state] : m_client_states) {
+            seal_batch(state);
+            // Full socket: EPOLLOUT picks it up (handle_client_writable)
+            if (state.send_buffer.would_block()) {
+                continue;
+            }
+            if (flush_client(state) < 0) {
+                m_dead_clients.push_back(fd);
+            }
+        }
+        m_batch_open_ns = 0;
+        reap_dead_clients();
+
+        for (auto it = m_recovery_clients.begin(); it != m_recovery_clients.end();) {
+            const int fd = it->first;
+            ++it;   // close_recovery_client erases
+            if (m_recovery_clients[fd].send_buffer.flush(fd) < 0) {
+                close_recovery_client(fd);
+            }
+        }
     }
 
-    uint32_t Random_Trade_Qty(SymbolData& temp_symbolData){
-        // Trades are usually smaller than quote depth
-        static thread_local std::uniform_int_distribution<uint32_t> trade_qty_dist(10, 2000);
+    // ---- Gap recovery side channel ----
 
-        return trade_qty_dist(temp_symbolData.st_rng);
+    bool OpenRecoveryListener(){
+        m_recovery_listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (m_recovery_listen_fd < 0) {
+            perror("recovery socket ");
+            return false;
+        }
+        int opt = 1;
+        setsockopt(m_recovery_listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(m_recovery_port);
+        if (m_bind_IP.empty() || inet_pton(AF_INET, m_bind_IP.c_str(), &addr.sin_addr) <= 0) {
+            addr.sin_addr.s_addr = INADDR_ANY;
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.fd = m_recovery_listen_fd;
+
+        if (bind(m_recovery_listen_fd, (sockaddr*)&addr, sizeof(addr)) < 0 ||
+            listen(m_recovery_listen_fd, SOMAXCONN) < 0 ||
+            epoll_ctl(m_epollFD, EPOLL_CTL_ADD, m_recovery_listen_fd, &ev) < 0) {
+            perror("recovery listener ");
+            close(m_recovery_listen_fd);
+            m_recovery_listen_fd = -1;
+            return false;
+        }
+        return true;
     }
 
-    void broadcast_message(const MarketMessage& msg){
-        // std::cout << "[SERVER] broadcast called, sym="
-        //   << msg.symbol_id << "\n";
+    void handle_new_recovery_connection(){
+        while (true) {
+            int fd = accept4(m_recovery_listen_fd, nullptr, nullptr, SOCK_NONBLOCK);
+            if (fd < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    perror("recovery accept");
+                }
+                break;
+            }
+            int flag = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
 
-        for (auto it = clients.begin(); it != clients.end(); ) {
-            int fd = *it;
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLET;
+            ev.data.fd = fd;
+            if (epoll_ctl(m_epollFD, EPOLL_CTL_ADD, fd, &ev) < 0) {
+                perror("epoll_ctl recovery");
+                close(fd);
+                continue;
+            }
+            m_recovery_clients.try_emplace(fd);
+        }
+    }
 
-            auto cs = m_client_states.find(fd);
-            if (cs == m_client_states.end() ||
-                cs->second.subscriptions.count(msg.symbol_id) == 0)
-            {
-                ++it;
+    // Each request is answered with the stored messages in the range followed
+    // by a RETRANSMIT_END marker; what fell out of the ring is simply absent
+    void handle_recovery_read(int fd){
+        RecoveryClient& rc = m_recovery_clients[fd];
+        uint8_t buffer[4096];
+
+        while (true) {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                rc.recv_buffer.insert(rc.recv_buffer.end(), buffer, buffer + n);
+            }
+            else if (n < 0 && errno == EINTR) {
                 continue;
             }
+            else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            else {
+                close_recovery_client(fd);
+                return;
+            }
+        }
+
+        size_t offset = 0;
+        while (rc.recv_buffer.size() - offset >= sizeof(RetransmitRequest)) {
+            RetransmitRequest req;
+            std::memcpy(&req, rc.recv_buffer.data() + offset, sizeof(req));
+            if (req.opcode != OPCODE_RETRANSMIT) {
+                close_recovery_client(fd);
+                return;
+            }
+            offset += sizeof(req);
+
+            const uint16_t symbol = ntohs(req.symbol_id);
+            const uint64_t to     = be64toh(req.to_sequence);
+            bool fits = true;
+            m_retransmit->replay(symbol, be64toh(req.from_sequence), to,
+                [&](const MarketMessage& wire) {
+                    fits = fits && rc.send_buffer.append(m_slab_pool.store(&wire, sizeof(wire)));
+                });
+
+            MarketMessage end{};
+            end.type = MessageType::RETRANSMIT_END;
+            end.symbol_id = symbol;
+            end.sequence = to;
+            end.timestamp_ns = GetTime_ns();
+            const MarketMessage wire = to_wire(end);
+            fits = fits && rc.send_buffer.append(m_slab_pool.store(&wire, sizeof(wire)));
+
+            // A client that asks for more than it reads is dropped
+            if (!fits) {
+                close_recovery_client(fd);
+                return;
+            }
+        }
+        rc.recv_buffer.erase(rc.recv_buffer.begin(), rc.recv_buffer.begin() + offset);
+
+        if (rc.send_buffer.flush(fd) < 0) {
+            close_recovery_client(fd);
+        }
+    }
 
-            MarketMessage wire = msg;  // copy host → wire
+    void close_recovery_client(int fd){
+        epoll_ctl(m_epollFD, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        m_recovery_clients.erase(fd);
+    }
 
-            wire.symbol_id    = htons(wire.symbol_id);
-            wire.sequence     = htobe64(wire.sequence);
-            wire.timestamp_ns = htobe64(wire.timestamp_ns);
+    // ---- Runtime control channel ----
 
-            if (wire.type == MessageType::QUOTE) {
-                uint64_t bp = htond(wire.quote.bid_price);
-                uint64_t ap = htond(wire.quote.ask_price);
-                std::memcpy(&wire.quote.bid_price, &bp, sizeof(bp));
-                std::memcpy(&wire.quote.ask_price, &ap, sizeof(ap));
-            } else {
-                uint64_t tp = htond(wire.trade.trade_price);
-                std::memcpy(&wire.trade.trade_price, &tp, sizeof(tp));
+    bool OpenControlListener(){
+        m_control_listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (m_control_listen_fd < 0) {
+            perror("control socket ");
+            return false;
+        }
+        int opt = 1;
+        setsockopt(m_control_listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(m_control_port);
+        if (m_bind_IP.empty() || inet_pton(AF_INET, m_bind_IP.c_str(), &addr.sin_addr) <= 0) {
+            addr.sin_addr.s_addr = INADDR_ANY;
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.fd = m_control_listen_fd;
+
+        if (bind(m_control_listen_fd, (sockaddr*)&addr, sizeof(addr)) < 0 ||
+            listen(m_control_listen_fd, SOMAXCONN) < 0 ||
+            epoll_ctl(m_epollFD, EPOLL_CTL_ADD, m_control_listen_fd, &ev) < 0) {
+            perror("control listener ");
+            close(m_control_listen_fd);
+            m_control_listen_fd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    void handle_new_control_connection(){
+        while (true) {
+            int fd = accept4(m_control_listen_fd, nullptr, nullptr, SOCK_NONBLOCK);
+            if (fd < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    perror("control accept");
+                }
+                break;
             }
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLET;
+            ev.data.fd = fd;
+            if (epoll_ctl(m_epollFD, EPOLL_CTL_ADD, fd, &ev) < 0) {
+                perror("epoll_ctl control");
+                close(fd);
+                continue;
+            }
+            m_control_clients.try_emplace(fd);
+        }
+    }
 
+    // One reply line per command line. Replies are tiny, so a send that
+    // does not go through in one call drops the connection.
+    void handle_control_read(int fd){
+        ControlClient& cc = m_control_clients[fd];
+        char buffer[1024];
 
-            ssize_t sent = send(fd, &msg, sizeof(MarketMessage),
-                                MSG_DONTWAIT | MSG_NOSIGNAL);
-            if (sent <= 0) {
-                std::cout<<"is the problem right here"<<std::endl;
-                handle_client_disconnect(fd);
+        while (true) {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                cc.recv_buffer.append(buffer, static_cast<size_t>(n));
+            }
+            else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            else {
+                close_control_client(fd);
+                return;
             }
-            
+        }
+        size_t start = 0;
+        size_t end;
+        std::string replies;
+        while ((end = cc.recv_buffer.find('\n', start)) != std::string::npos) {
+            replies += handle_control_command(cc.recv_buffer.substr(start, end - start));
+            start = end + 1;
+        }
+        cc.recv_buffer.erase(0, start);
+        if (cc.recv_buffer.size() > MAX_CONTROL_LINE) {
+            close_control_client(fd);
+            return;
+        }
 
-            if (sent != sizeof(msg)) {
-                handle_client_disconnect(fd);
-                m_client_states.erase(fd);
-                it = clients.erase(it);
-            } else {
-                ++it;
+        if (!replies.empty() &&
+            send(fd, replies.data(), replies.size(), MSG_DONTWAIT | MSG_NOSIGNAL) != static_cast<ssize_t>(replies.size())) {
+            close_control_client(fd);
+        }
+    }
+
+    std::string handle_control_command(const std::string& line){
+        std::istringstream in(line);
+        std::string cmd;
+        in >> cmd;
+        const uint64_t elapsed = GetTime_ns() - m_profile_start_ns;
+
+        if (cmd == "RATE") {
+            uint32_t rate = 0;
+            if (!(in >> rate) || rate == 0) {
+                return "ERR usage: RATE <ticks/s>\n";
+            }
+            m_profile.shape = LoadShape::CONSTANT;
+            m_profile.base_rate = rate;
+        }
+        else if (cmd == "PROFILE") {
+            std::string name;
+            double period_sec = 0.0;
+            in >> name;
+            if (!LoadProfile::parse_shape(name, m_profile.shape)) {
+                return "ERR usage: PROFILE CONSTANT|STEP|SINE|BURST [period_sec]\n";
+            }
+            if (in >> period_sec && period_sec > 0.0) {
+                m_profile.period_ns = static_cast<uint64_t>(period_sec * 1e9);
+            }
+            // New shape starts from the beginning of its period
+            m_profile_start_ns = GetTime_ns();
+            m_profile.spike_until_ns = 0;
+        }
+        else if (cmd == "SPIKE") {
+            uint32_t multiplier = 0;
+            uint64_t duration_ms = 0;
+            if (!(in >> multiplier >> duration_ms) || multiplier == 0) {
+                return "ERR usage: SPIKE <multiplier> <ms>\n";
             }
+            m_profile.spike_multiplier = multiplier;
+            m_profile.spike_until_ns = elapsed + duration_ms * 1'000'000ULL;
+        }
+        else if (cmd != "STATUS") {
+            return "ERR unknown command\n";
+        }
+
+        // Apply right away rather than at the next profile update
+        set_tick_rate(m_profile.rate_at(GetTime_ns() - m_profile_start_ns));
+
+        size_t queued = 0;
+        for (auto& shard : m_shards) {
+            queued += shard->queue.size_approx();
+        }
+        size_t backlog = 0;
+        size_t conflating = 0;
+        for (auto& [fd, state] : m_client_states) {
+            backlog += state.send_buffer.pending();
+            conflating += state.conflating ? 1 : 0;
+        }
+        std::ostringstream out;
+        out << "OK rate=" << m_ticks_per_second
+            << " profile=" << LoadProfile::shape_name(m_profile.shape)
+            << " queued=" << queued
+            << " backlog_bytes=" << backlog
+            << " conflating=" << conflating
+            << " clients=" << m_client_states.size() << "\n";
+        return out.str();
+    }
+
+    void close_control_client(int fd){
+        epoll_ctl(m_epollFD, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        m_control_clients.erase(fd);
+    }
+
+    void reap_dead_clients(){
+        for (int fd : m_dead_clients) {
+            handle_client_disconnect(fd);
         }
+        m_dead_clients.clear();
     }
 
     // void handle_client_disconnect(int clientFD){
@@ -635,7 +1524,6 @@ class ExchangeSimulator{
             else if (n == 0) {
                 // Clean disconnect
                 handle_client_disconnect(client_fd);
-                m_client_states.erase(client_fd);
                 return;
             }
             else {
@@ -644,53 +1532,120 @@ class ExchangeSimulator{
                 }
                 // Fatal error
                 handle_client_disconnect(client_fd);
-                m_client_states.erase(client_fd);
                 return;
             }
         }
 
         // ---- PARSING LOOP ----
+        // [0xFF][count u16][ids]                    v1 feed
+        // [0xFD][version u8][flags u8][count u16][ids]  negotiated feed
+        // [0xFC|0xFB|0xFA][count u16][ids]          add / remove / replace
         while (true) {
-            if (state.recv_buffer.size() < 3) {
-                return; // Not enough for header + count
+            if (state.recv_buffer.empty()) {
+                return;
             }
 
-            if (state.recv_buffer[0] != 0xFF) {
+            const uint8_t opcode = state.recv_buffer[0];
+            size_t header = 0;
+            if (opcode == OPCODE_SUBSCRIBE || opcode == OPCODE_SUBSCRIBE_ADD ||
+                opcode == OPCODE_UNSUBSCRIBE || opcode == OPCODE_SUBSCRIBE_REPLACE) {
+                header = 1 + 2;
+            } else if (opcode == OPCODE_SUBSCRIBE_V2) {
+                header = 1 + 1 + 1 + 2;
+            } else {
                 // Protocol violation
                 handle_client_disconnect(client_fd);
-                m_client_states.erase(client_fd);
                 return;
             }
 
+            if (state.recv_buffer.size() < header) {
+                return; // Not enough for header + count
+            }
+
             uint16_t count;
-            std::memcpy(&count, &state.recv_buffer[1], sizeof(uint16_t));
+            std::memcpy(&count, &state.recv_buffer[header - 2], sizeof(uint16_t));
             count = ntohs(count);
 
-            if (count == 0 || count > 500) {
+            if (count > MAX_SUBSCRIBE_COUNT) {
                 handle_client_disconnect(client_fd);
-                m_client_states.erase(client_fd);
                 return;
             }
 
-            size_t required = 1 + 2 + count * 2;
+            size_t required = header + count * 2;
             if (state.recv_buffer.size() < required) {
                 return; // Wait for more data
             }
 
+            // Version and framing apply to everything sent from now on
+            if (opcode == OPCODE_SUBSCRIBE_V2) {
+                const uint8_t requested = state.recv_buffer[1];
+                const uint8_t flags     = state.recv_buffer[2];
+                seal_batch(state);
+                state.wire_version = std::max(PROTOCOL_VERSION_1, std::min(requested, PROTOCOL_VERSION_MAX));
+                state.batch_frames = state.wire_version >= PROTOCOL_VERSION_2 &&
+                                     (flags & SUBSCRIBE_FLAG_BATCH) != 0;
+                state.snapshots = (flags & SUBSCRIBE_FLAG_SNAPSHOT) != 0;
+
+                // Only honoured while the group is up; otherwise data stays on TCP
+                const bool multicast = m_multicast.is_open() && (flags & SUBSCRIBE_FLAG_MULTICAST) != 0;
+                if (multicast != state.multicast) {
+                    for (uint16_t sym = MIN_SYMBOL_ID; sym <= MAX_SYMBOL_ID; ++sym) {
+                        if (!state.subscriptions.test(sym)) {
+                            continue;
+                        }
+                        if (multicast) {
+                            m_subscription_index.unsubscribe(sym, state.slot);
+                        } else {
+                            m_subscription_index.subscribe(sym, state.slot);
+                        }
+                    }
+                }
+                state.multicast = multicast;
+            }
+
             // Parse symbol IDs
+            std::bitset<MAX_SYMBOL_ID + 1> listed;
             for (size_t i = 0; i < count; ++i) {
                 uint16_t sym;
                 std::memcpy(
                     &sym,
-                    &state.recv_buffer[3 + i * 2],
+                    &state.recv_buffer[header + i * 2],
                     sizeof(uint16_t)
                 );
                 sym = ntohs(sym);
 
-                if (sym >= 1 && sym <= 500) {
-                    state.subscriptions.insert(sym);
+                if (sym >= MIN_SYMBOL_ID && sym <= MAX_SYMBOL_ID) {
+                    listed.set(sym);
+                }
+            }
+
+            // Only the difference touches the index
+            std::bitset<MAX_SYMBOL_ID + 1> next = state.subscriptions;
+            if (opcode == OPCODE_UNSUBSCRIBE) {
+                next &= ~listed;
+            } else if (opcode == OPCODE_SUBSCRIBE_REPLACE) {
+                next = listed;
+            } else {
+                next |= listed;
+            }
+            const std::bitset<MAX_SYMBOL_ID + 1> changed = next ^ state.subscriptions;
+            state.subscriptions = next;
+            if (!state.multicast && changed.any()) {
+                for (uint16_t sym = MIN_SYMBOL_ID; sym <= MAX_SYMBOL_ID; ++sym) {
+                    if (!changed.test(sym)) {
+                        continue;
+                    }
+                    if (next.test(sym)) {
+                        m_subscription_index.subscribe(sym, state.slot);
+                    } else {
+                        m_subscription_index.unsubscribe(sym, state.slot);
+                    }
                 }
             }
+            if (state.snapshots && !send_snapshots(state, changed & next)) {
+                handle_client_disconnect(client_fd);
+                return;
+            }
         //     std::cout << "[SERVER] Client " << client_fd
         //   << " subscribed to " << state.subscriptions.size()
         //   << " symbols\n";
@@ -705,10 +1660,19 @@ class ExchangeSimulator{
 
     void handle_client_disconnect(int clientFD)
     {
+        // Already reaped (e.g. queued twice in m_dead_clients)
+        if (clients.erase(clientFD) == 0) {
+            return;
+        }
         epoll_ctl(m_epollFD, EPOLL_CTL_DEL, clientFD, nullptr);
         close(clientFD);
 
-        // clients.erase(clientFD);
+        auto it = m_client_states.find(clientFD);
+        if (it != m_client_states.end()) {
+            m_subscription_index.release_slot(it->second.slot);
+            m_slot_clients[it->second.slot] = nullptr;
+            m_client_states.erase(it);
+        }
 
         // Optional logging
         // std::cout << "Client disconnected: fd=" << clientFD << "\n";
@@ -756,21 +1720,37 @@ class ExchangeSimulator{
                 continue;
             }
 
+            int slot = m_subscription_index.acquire_slot();
+            if (slot < 0) {
+                std::cerr << "Client limit reached, rejecting fd=" << client_fd << "\n";
+                close(client_fd);
+                continue;
+            }
+
             // Register with epoll
             epoll_event ev{};
             // ev.events = EPOLLERR | EPOLLHUP;  // read not required (broadcast-only)
-            ev.events = EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLET;
+            // EPOLLOUT (edge) resumes a client whose socket filled up
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLERR | EPOLLHUP | EPOLLET;
 
             ev.data.fd = client_fd;
 
             if (epoll_ctl(m_epollFD, EPOLL_CTL_ADD, client_fd, &ev) < 0) {
                 perror("epoll_ctl client");
+                m_subscription_index.release_slot(slot);
                 close(client_fd);
                 continue;
             }
 
             clients.insert(client_fd);
-            m_client_states.emplace(client_fd, ClientState{});
+            ClientState& state = m_client_states.try_emplace(client_fd).first->second;
+            state.fd   = client_fd;
+            state.slot = slot;
+            state.send_buffer.set_capacity(m_client_queue_bytes);
+            m_slot_clients[slot] = &state;
+            if (m_faults.enabled()) {
+                m_faults.attach(state.faults, slot, GetTime_ns());
+            }
 
             // Optional logging
             // std::cout << "Client connected: fd=" << client_fd << "\n";
@@ -778,33 +1758,38 @@ class ExchangeSimulator{
     }
 
 
-    SymbolData GenerateSymbol(uint16_t symbolId,const std::unique_ptr<ConfigManager>& cfg){
-        SymbolData temp{};  //creating a temporary SymbolData
-
-        temp.st_symbolID=symbolId;
-        temp.st_symbolSequenceNumber=0;
+    // Initial parameters come from a per-symbol mt19937_64 (cold path, runs once);
+    // per-tick randomness comes from the counter-based generator in gbm_kernel.hpp
+    void GenerateSymbol(uint16_t symbolId,const std::unique_ptr<ConfigManager>& cfg){
+        SymbolStore& st = m_symbolState;
+        std::mt19937_64 rng(cfg->m_seed^symbolId);
 
-        temp.st_rng.seed(cfg->m_seed^symbolId);
+        st.sequence[symbolId]=0;
+        st.draw_counter[symbolId]=0;
 
         std::uniform_real_distribution<double> priceDist(cfg->m_priceMin, cfg->m_priceMax);
-        temp.st_symbolPrice=priceDist(temp.st_rng);
-        
+        st.price[symbolId]=priceDist(rng);
 
         std::uniform_real_distribution<double> volatileDist(cfg->m_volatilityMin,cfg->m_volatilityMax);
-        temp.st_symbolSIGMA=volatileDist(temp.st_rng);
+        st.sigma[symbolId]=volatileDist(rng);
 
         std::uniform_real_distribution<double> spreadDist(cfg->m_spreadMin,  cfg->m_spreadMax);
-        temp.st_symbolSpread=spreadDist(temp.st_rng);
+        st.spread[symbolId]=spreadDist(rng);
 
-        temp.st_symbolMU=cfg->m_marketDrift;
+        st.mu[symbolId]=cfg->m_marketDrift;
 
-        const double halfSpread = temp.st_symbolSpread * 0.5;
-        temp.st_bidPrice = temp.st_symbolPrice*(1-halfSpread);
-        temp.st_askPrice  = temp.st_symbolPrice*(1+halfSpread);
+        // Geometric Brownian Motion terms are constant per symbol: precompute them
+        const double sigma = st.sigma[symbolId];
+        st.drift_dt[symbolId]    = (st.mu[symbolId] - 0.5 * sigma * sigma) * m_dt;
+        st.vol_sqrt_dt[symbolId] = sigma * std::sqrt(m_dt);
 
-        temp.st_timeStamp = GetTime_ns();
+        const double halfSpread = st.spread[symbolId] * 0.5;
+        st.half_spread[symbolId] = halfSpread;
+        st.bid[symbolId] = st.price[symbolId]*(1-halfSpread);
+        st.ask[symbolId] = st.price[symbolId]*(1+halfSpread);
 
-        return temp;
+        st.timestamp[symbolId] = GetTime_ns();
+        m_top_of_book.seed(symbolId, st.bid[symbolId], st.ask[symbolId], st.timestamp[symbolId]);
     }
     public:
     void request_shutdown() {
@@ -814,7 +1799,11 @@ class ExchangeSimulator{
 
     private:
     //Symbol Generation and Storage
-    std::array<SymbolData, 501> m_symbolState;
+    SymbolStore m_symbolState;
+    bool m_scalar_kernel{false};   // TICKS.KERNEL = SCALAR: reference path, same bits as BATCH
+    uint32_t m_depth_levels{1};   // 1 = top of book only
+    bool m_spin_loop{false};      // SERVER.LOOPMODE = SPIN: zero-timeout epoll, TSC paced workers
+    TscClock m_clock;             // network thread's clock in spin mode
     std::vector<int16_t> m_activeSymbols;
     size_t m_activeSymbolCounts;
 
@@ -845,8 +1834,59 @@ class ExchangeSimulator{
     uint64_t m_runDurationSec;
     std::atomic<bool> m_shutdown_requested{false};
     inline static ExchangeSimulator* s_instance = nullptr;
+    SlabPool m_slab_pool;   // declared before m_client_states: queues release into it
     std::unordered_map<int, ClientState> m_client_states;
-
+    TopOfBookTable m_top_of_book;   // network thread's view, for snapshots
+    uint64_t m_snapshots_sent{0};
+    SubscriptionIndex m_subscription_index;   // symbol id -> bitmap of client slots
+    std::array<ClientState*, SubscriptionIndex::MAX_CLIENTS> m_slot_clients{};   // slot -> state (map nodes are stable)
+
+    //Gap Recovery
+    std::unique_ptr<RetransmitStore> m_retransmit;   // last RECOVERY.DEPTH messages per symbol
+    uint16_t m_recovery_port{0};
+    int m_recovery_listen_fd{-1};
+    std::unordered_map<int, RecoveryClient> m_recovery_clients;
+
+    //Load Profile / Control Channel
+    static constexpr uint64_t PROFILE_UPDATE_NS = 10'000'000;   // rate re-evaluated every 10 ms
+    static constexpr size_t MAX_CONTROL_LINE = 4096;
+    LoadProfile m_profile;
+    uint64_t m_profile_start_ns{0};
+    uint64_t m_profile_next_ns{0};
+    uint16_t m_control_port{0};
+    int m_control_listen_fd{-1};
+    std::unordered_map<int, ControlClient> m_control_clients;
+
+    //Slow Consumers
+    size_t m_client_queue_bytes{OutboundBuffer::DEFAULT_CAPACITY};   // pending bytes before a client is dropped
+    size_t m_conflate_high_water{0};   // 0 = never conflate
+    size_t m_conflate_low_water{0};
+    uint64_t m_conflate_max_ns{0};     // 0 = conflate for as long as it takes
+    uint64_t m_conflation_episodes{0};
+    uint64_t m_conflated_messages{0};
+    uint64_t m_conflation_timeouts{0};
+
+    //Fault Injection
+    FaultInjector m_faults;
+
+    //Multicast Distribution
+    MulticastPublisher m_multicast;
+    bool m_multicast_enabled{false};
+    std::string m_multicast_group;
+    uint16_t m_multicast_port{0};
+    std::string m_multicast_iface;
+    int m_multicast_ttl{1};
+
+    //Tick Generator Shards
+    std::vector<std::unique_ptr<TickShard>> m_shards;
+    std::atomic<bool> m_workers_stop{false};
+    int m_network_core{2};
+
+    //Broadcast Batching
+    uint32_t m_max_batch_bytes{16384};
+    uint64_t m_max_batch_delay_ns{100'000};
+    uint64_t m_batch_open_ns{0};        // timestamp of the oldest unflushed tick
+    std::vector<int> m_dead_clients;    // reaped after each broadcast / flush pass
 };
 
 #endif
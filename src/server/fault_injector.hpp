@@ -0,0 +1,177 @@
+#ifndef FAULT_INJECTOR_HPP
+#define FAULT_INJECTOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include "../common/protocol.hpp"
+#include "wire_slab.hpp"
+
+// Adversarial delivery for exercising a feed handler's recovery paths.
+// Sits between encoding and a client's send queue (per message faults) and
+// in front of sendmsg() (per flush faults). The retransmit store always sees
+// the clean stream, so every dropped tick can be recovered.
+//
+// Per message, each with its own probability:
+//   drop       not queued for this client
+//   duplicate  queued twice
+//   reorder    held back and queued after the client's next message
+//   corrupt    one payload bit flipped (header, so framing, symbol and sequence kept)
+// Per flush:
+//   split      the send stops at a random byte, usually inside a message
+//   throttle   a token bucket caps each client at throttle_bytes_per_sec
+struct FaultConfig {
+    double drop{0.0};
+    double duplicate{0.0};
+    double reorder{0.0};
+    double corrupt{0.0};
+    double split{0.0};
+    uint64_t throttle_bytes_per_sec{0};   // 0 = unthrottled
+};
+
+// Fault state of one client. Each client draws from its own generator,
+// seeded from the simulator seed and its subscription slot, so its fault
+// pattern does not depend on what other clients are connected.
+struct ClientFaults {
+    std::mt19937_64 rng;
+    WireRef held{nullptr, 0, 0};   // reordered message waiting for the next one
+    double tokens{0.0};            // throttle budget in bytes
+    uint64_t refill_ns{0};
+
+    ClientFaults() = default;
+    ClientFaults(const ClientFaults&) = delete;
+    ClientFaults& operator=(const ClientFaults&) = delete;
+
+    ~ClientFaults() { release_held(); }
+
+    bool holding() const { return held.slab != nullptr; }
+
+    void release_held() {
+        if (held.slab != nullptr) {
+            SlabPool::release(held.slab);
+            held.slab = nullptr;
+        }
+    }
+};
+
+class FaultInjector {
+public:
+    enum Action : uint32_t {
+        NONE      = 0,
+        DROP      = 1u << 0,
+        DUPLICATE = 1u << 1,
+        REORDER   = 1u << 2,
+        CORRUPT   = 1u << 3,
+    };
+
+    // Throttled clients may burst up to this much of a second's budget
+    static constexpr double THROTTLE_BURST_SEC = 0.01;
+
+    void enable(const FaultConfig& config, uint64_t seed) {
+        m_config  = config;
+        m_seed    = seed;
+        m_enabled = true;
+    }
+
+    bool enabled() const { return m_enabled; }
+    const FaultConfig& config() const { return m_config; }
+
+    void attach(ClientFaults& client, int slot, uint64_t now_ns) const {
+        client.rng.seed(m_seed ^ (0x9E3779B97F4A7C15ULL * static_cast<uint64_t>(slot + 1)));
+        client.tokens    = 0.0;
+        client.refill_ns = now_ns;
+    }
+
+    // Which faults hit the next message for this client
+    uint32_t decide(ClientFaults& client) {
+        uint32_t action = NONE;
+        if (roll(client, m_config.drop)) {
+            ++m_dropped;
+            return DROP;
+        }
+        if (roll(client, m_config.duplicate)) {
+            action |= DUPLICATE;
+            ++m_duplicated;
+        }
+        if (!client.holding() && roll(client, m_config.reorder)) {
+            action |= REORDER;
+            ++m_reordered;
+        }
+        if (roll(client, m_config.corrupt)) {
+            action |= CORRUPT;
+        }
+        return action;
+    }
+
+    // Flips one bit of the frame's payload: prices, quantities, side. The
+    // header (v2 Header, or v1 type .. timestamp_ns) is left alone, so the
+    // stream stays framed and the message keeps its symbol and sequence;
+    // the damage is a wrong value, not a gap. Header-only frames are kept.
+    void corrupt(ClientFaults& client, uint8_t* frame, size_t len) {
+        // A v1 message starts with a zero byte, a v2 frame with its length
+        const size_t header = frame[0] == 0 ? offsetof(MarketMessage, quote) : sizeof(v2::Header);
+        if (len <= header) {
+            return;
+        }
+        std::uniform_int_distribution<size_t> at(header, len - 1);
+        std::uniform_int_distribution<int> bit(0, 7);
+        frame[at(client.rng)] ^= static_cast<uint8_t>(1u << bit(client.rng));
+        ++m_corrupted;
+    }
+
+    // Bytes this flush may send: SIZE_MAX when unconstrained, 0 to skip it
+    size_t flush_limit(ClientFaults& client, size_t pending, uint64_t now_ns) {
+        size_t limit = SIZE_MAX;
+        if (m_config.throttle_bytes_per_sec != 0) {
+            const double rate = static_cast<double>(m_config.throttle_bytes_per_sec);
+            client.tokens = std::min(client.tokens + rate * (now_ns - client.refill_ns) * 1e-9,
+                                     std::max(rate * THROTTLE_BURST_SEC, 1.0));
+            client.refill_ns = now_ns;
+            limit = static_cast<size_t>(client.tokens);
+            if (limit < pending) {
+                ++m_throttled;
+            }
+        }
+        if (pending > 1 && roll(client, m_config.split)) {
+            std::uniform_int_distribution<size_t> cut(1, pending - 1);
+            limit = std::min(limit, cut(client.rng));
+            ++m_split;
+        }
+        return limit;
+    }
+
+    void on_sent(ClientFaults& client, size_t bytes) {
+        if (m_config.throttle_bytes_per_sec != 0) {
+            client.tokens -= static_cast<double>(bytes);
+        }
+    }
+
+    uint64_t dropped() const { return m_dropped; }
+    uint64_t duplicated() const { return m_duplicated; }
+    uint64_t reordered() const { return m_reordered; }
+    uint64_t corrupted() const { return m_corrupted; }
+    uint64_t split() const { return m_split; }
+    uint64_t throttled() const { return m_throttled; }
+
+private:
+    static bool roll(ClientFaults& client, double p) {
+        if (p <= 0.0) {
+            return false;
+        }
+        return std::uniform_real_distribution<double>(0.0, 1.0)(client.rng) < p;
+    }
+
+    FaultConfig m_config;
+    uint64_t m_seed{0};
+    bool m_enabled{false};
+
+    uint64_t m_dropped{0};
+    uint64_t m_duplicated{0};
+    uint64_t m_reordered{0};
+    uint64_t m_corrupted{0};
+    uint64_t m_split{0};
+    uint64_t m_throttled{0};   // flushes cut short by the token bucket
+};
+
+#endif
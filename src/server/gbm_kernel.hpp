@@ -0,0 +1,350 @@
+#ifndef GBM_KERNEL_HPP
+#define GBM_KERNEL_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include "ConfigManager.hpp"
+
+// ---------------------------------------------------------------------------
+// Batched Geometric Brownian Motion kernel over a structure-of-arrays store.
+//
+// Randomness comes from Philox4x32-10, a counter-based generator: every draw
+// is a pure function of (m_seed, symbol id, per-symbol draw counter), so no
+// generator state has to be loaded per tick and lanes are independent.
+// Normals are produced with Box-Muller and all transcendental functions are
+// branch-free polynomials built from plain arithmetic and bit operations.
+//
+// The batched path processes GBM_LANES ticks per block with fixed-trip loops
+// the compiler turns into SIMD code; the scalar path runs the very same
+// per-lane functions one tick at a time. Both produce identical bits for the
+// same seed as long as floating point contraction is disabled
+// (-ffp-contract=off, set in CMakeLists.txt; -fno-math-errno lets sqrt vectorize).
+// ---------------------------------------------------------------------------
+
+namespace gbm {
+
+static constexpr size_t GBM_LANES = 8;
+
+inline uint64_t AsBits(double d) { uint64_t u; std::memcpy(&u, &d, sizeof(u)); return u; }
+inline double AsDouble(uint64_t u) { double d; std::memcpy(&d, &u, sizeof(d)); return d; }
+
+struct PhiloxOut {
+    uint32_t w0, w1, w2, w3;
+};
+
+inline PhiloxOut Philox4x32(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3,
+                            uint32_t k0, uint32_t k1) {
+    constexpr uint64_t M0 = 0xD2511F53;
+    constexpr uint64_t M1 = 0xCD9E8D57;
+    constexpr uint32_t W0 = 0x9E3779B9;
+    constexpr uint32_t W1 = 0xBB67AE85;
+
+    for (int round = 0; round < 10; ++round) {
+        const uint64_t p0 = M0 * c0;
+        const uint64_t p1 = M1 * c2;
+        const uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+        const uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+        c1 = static_cast<uint32_t>(p1);
+        c3 = static_cast<uint32_t>(p0);
+        c0 = n0;
+        c2 = n2;
+        k0 += W0;
+        k1 += W1;
+    }
+    return {c0, c1, c2, c3};
+}
+
+// 32 random bits -> uniform double in the open interval (0, 1)
+inline double ToOpenUniform(uint32_t w) {
+    const uint64_t bits = 0x3FF0000000000000ULL | (static_cast<uint64_t>(w) << 20) | (1ULL << 19);
+    return AsDouble(bits) - 1.0;
+}
+
+// Natural log for x > 0 (normal, finite)
+inline double FastLog(double x) {
+    constexpr double LN2 = 0.6931471805599453;
+    constexpr uint64_t SQRT_HALF_BITS = 0x3FE6A09E667F3BCDULL;   // sqrt(2)/2
+
+    // x = 2^e * m with m in [sqrt(2)/2, sqrt(2)), done entirely on the bits
+    const uint64_t ix = AsBits(x) + (0x3FF0000000000000ULL - SQRT_HALF_BITS);
+    // exponent as a double without an int->double conversion
+    const double e = AsDouble(0x4330000000000000ULL | (ix >> 52)) - 4503599627370496.0 - 1023.0;
+    const double m = AsDouble((ix & 0x000FFFFFFFFFFFFFULL) + SQRT_HALF_BITS);
+
+    // log(m) = 2 atanh(s), s = (m-1)/(m+1), |s| < 0.172
+    const double s  = (m - 1.0) / (m + 1.0);
+    const double s2 = s * s;
+    const double p  = 1.0 + s2 * (1.0 / 3 + s2 * (1.0 / 5 + s2 * (1.0 / 7 + s2 * (1.0 / 9
+                    + s2 * (1.0 / 11 + s2 * (1.0 / 13 + s2 * (1.0 / 15)))))));
+    return 2.0 * s * p + e * LN2;
+}
+
+// e^x for |x| < 700
+inline double FastExp(double x) {
+    constexpr double LOG2E  = 1.4426950408889634;
+    constexpr double LN2_HI = 0.6931471803691238;
+    constexpr double LN2_LO = 1.9082149292705877e-10;
+    constexpr double SHIFT  = 6755399441055744.0;   // 1.5 * 2^52, rounds to integer
+
+    const double t  = x * LOG2E + SHIFT;
+    const double kd = t - SHIFT;
+    const int64_t k = static_cast<int64_t>(AsBits(t) - AsBits(SHIFT));
+
+    const double r = (x - kd * LN2_HI) - kd * LN2_LO;   // |r| <= ln2 / 2
+    double p = 1.0 + r * (1.0 + r * (1.0 / 2 + r * (1.0 / 6 + r * (1.0 / 24 + r * (1.0 / 120
+             + r * (1.0 / 720 + r * (1.0 / 5040 + r * (1.0 / 40320 + r * (1.0 / 362880
+             + r * (1.0 / 3628800 + r * (1.0 / 39916800)))))))))));
+    return AsDouble(AsBits(p) + (static_cast<uint64_t>(k) << 52));
+}
+
+// sin/cos of 2*pi*u where u is the 32-bit word w read as a fraction of 2^32.
+// The top two bits pick the quadrant, the rest give the angle inside it;
+// quadrant fix-ups are bit selects so the function stays branch-free.
+inline void SinCos2Pi(uint32_t w, double& sin_out, double& cos_out) {
+    constexpr double HALF_PI = 1.5707963267948966;
+
+    const uint64_t q = w >> 30;
+    const double a  = ToOpenUniform(w << 2) * HALF_PI;   // (0, pi/2)
+    const double a2 = a * a;
+
+    const double s = a * (1.0 - a2 * (1.0 / 6 - a2 * (1.0 / 120 - a2 * (1.0 / 5040
+                   - a2 * (1.0 / 362880 - a2 * (1.0 / 39916800 - a2 * (1.0 / 6227020800.0)))))));
+    const double c = 1.0 - a2 * (1.0 / 2 - a2 * (1.0 / 24 - a2 * (1.0 / 720 - a2 * (1.0 / 40320
+                   - a2 * (1.0 / 3628800 - a2 * (1.0 / 479001600 - a2 * (1.0 / 87178291200.0)))))));
+
+    // q: 0 -> ( s,  c)  1 -> ( c, -s)  2 -> (-s, -c)  3 -> (-c,  s)
+    const uint64_t swap = 0 - (q & 1);
+    const uint64_t sb = AsBits(s);
+    const uint64_t cb = AsBits(c);
+    const uint64_t sin_bits = ((sb & ~swap) | (cb & swap)) ^ ((q >> 1) << 63);
+    const uint64_t cos_bits = ((cb & ~swap) | (sb & swap)) ^ (((q ^ (q >> 1)) & 1) << 63);
+    sin_out = AsDouble(sin_bits);
+    cos_out = AsDouble(cos_bits);
+}
+
+// Everything a single tick needs, derived from one Philox block
+struct LaneDraw {
+    double growth;      // price multiplier exp((mu - sigma^2/2) dt + sigma sqrt(dt) Z)
+    double bid_qty;
+    double ask_qty;
+    uint32_t trade_qty;
+    uint32_t aggressor_buy;
+};
+
+inline double ClampQty(double q) {
+    q = q < 10.0 ? 10.0 : q;
+    return q > 10000.0 ? 10000.0 : q;
+}
+
+// Normals -> tick fields
+inline LaneDraw FinishLane(uint32_t w2, uint32_t w3, double z0, double z1, double z2,
+                           double drift_dt, double vol_sqrt_dt) {
+    LaneDraw d;
+    d.growth  = FastExp(drift_dt + vol_sqrt_dt * z0);
+    // Log-normal gives realistic size distribution (mu = 3.5, sigma = 0.8 in log space)
+    d.bid_qty = ClampQty(FastExp(3.5 + 0.8 * z1));
+    d.ask_qty = ClampQty(FastExp(3.5 + 0.8 * z2));
+    // Trades are usually smaller than quote depth: uniform [10, 2000]
+    d.trade_qty     = 10 + static_cast<uint32_t>((static_cast<uint64_t>(w2) * 1991) >> 32);
+    d.aggressor_buy = w3 >> 31;
+    return d;
+}
+
+// Scalar draw for one tick
+inline LaneDraw DrawLane(uint64_t counter, uint16_t symbol, uint32_t k0, uint32_t k1,
+                         double drift_dt, double vol_sqrt_dt) {
+    const PhiloxOut w = Philox4x32(static_cast<uint32_t>(counter),
+                                   static_cast<uint32_t>(counter >> 32),
+                                   symbol, 0, k0, k1);
+
+    // Box-Muller: (w0, w1) -> z0, z1 ; (w2, w3) -> z2
+    const double r01 = std::sqrt(-2.0 * FastLog(ToOpenUniform(w.w0)));
+    const double r23 = std::sqrt(-2.0 * FastLog(ToOpenUniform(w.w2)));
+    double s01, c01, s23, c23;
+    SinCos2Pi(w.w1, s01, c01);
+    SinCos2Pi(w.w3, s23, c23);
+
+    return FinishLane(w.w2, w.w3, r01 * c01, r01 * s01, r23 * c23, drift_dt, vol_sqrt_dt);
+}
+
+// Philox4x32-10 over GBM_LANES counters at once; rounds outside, lanes inside.
+// The key schedule is shared by every lane.
+inline void PhiloxLanes(const uint64_t* counter, const uint16_t* symbol, uint32_t k0, uint32_t k1,
+                        uint32_t* w0, uint32_t* w1, uint32_t* w2, uint32_t* w3) {
+    constexpr uint64_t M0 = 0xD2511F53;
+    constexpr uint64_t M1 = 0xCD9E8D57;
+
+    for (size_t i = 0; i < GBM_LANES; ++i) {
+        w0[i] = static_cast<uint32_t>(counter[i]);
+        w1[i] = static_cast<uint32_t>(counter[i] >> 32);
+        w2[i] = symbol[i];
+        w3[i] = 0;
+    }
+    for (int round = 0; round < 10; ++round) {
+        for (size_t i = 0; i < GBM_LANES; ++i) {
+            const uint64_t p0 = M0 * w0[i];
+            const uint64_t p1 = M1 * w2[i];
+            const uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ w1[i] ^ k0;
+            const uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ w3[i] ^ k1;
+            w1[i] = static_cast<uint32_t>(p1);
+            w3[i] = static_cast<uint32_t>(p0);
+            w0[i] = n0;
+            w2[i] = n2;
+        }
+        k0 += 0x9E3779B9;
+        k1 += 0xBB67AE85;
+    }
+}
+
+} // namespace gbm
+
+// Structure-of-arrays symbol state indexed by symbol id.
+// Hot per-tick fields sit in their own dense arrays, so a burst only pulls
+// in the cache lines of the symbols it actually touches.
+struct SymbolStore {
+    static constexpr size_t CAPACITY = MAX_SYMBOL_ID + 1;
+
+    alignas(64) std::array<double, CAPACITY> price{};
+    alignas(64) std::array<double, CAPACITY> bid{};
+    alignas(64) std::array<double, CAPACITY> ask{};
+    alignas(64) std::array<double, CAPACITY> drift_dt{};      // (mu - sigma^2/2) * dt
+    alignas(64) std::array<double, CAPACITY> vol_sqrt_dt{};   // sigma * sqrt(dt)
+    alignas(64) std::array<double, CAPACITY> half_spread{};
+    alignas(64) std::array<uint64_t, CAPACITY> draw_counter{};
+    alignas(64) std::array<uint64_t, CAPACITY> sequence{};
+    std::array<uint8_t, CAPACITY> depth_cursor{};   // next deeper level to refresh (multi-level mode)
+
+    // cold: kept for reporting
+    std::array<double, CAPACITY> mu{};
+    std::array<double, CAPACITY> sigma{};
+    std::array<double, CAPACITY> spread{};
+    std::array<uint64_t, CAPACITY> timestamp{};
+
+    uint32_t key0{0};
+    uint32_t key1{0};
+
+    void SetSeed(uint64_t seed) {
+        key0 = static_cast<uint32_t>(seed);
+        key1 = static_cast<uint32_t>(seed >> 32);
+    }
+
+    void PrintInfo(uint16_t id) const {
+        std::cout<<"-------------------------------------------------------------------------------\n";
+        std::cout<<"st_symbolID : "<<id<<"\nst_symbolPrice : "<<price[id]<<" ,st_bidPrice : "<<bid[id]
+        <<" ,st_askPrice : "<<ask[id]<<" ,st_symbolMU : "<<mu[id]<<" ,st_symbolSIGMA : "<<sigma[id]
+        <<" ,st_symbolSpread : "<<spread[id]<<" ,st_symbolSequenceNumber : "<<sequence[id]
+        <<" ,st_timeStamp : "<<timestamp[id]<<"\n";
+    }
+};
+
+// Result of evolving a burst of ticks; entry i belongs to symbol[i]
+struct TickBurst {
+    static constexpr size_t MAX_TICKS = 256;
+
+    size_t count{0};
+    uint16_t symbol[MAX_TICKS];
+    double bid[MAX_TICKS];
+    double ask[MAX_TICKS];
+    uint32_t bid_qty[MAX_TICKS];
+    uint32_t ask_qty[MAX_TICKS];
+    uint32_t trade_qty[MAX_TICKS];
+    uint8_t aggressor_buy[MAX_TICKS];
+};
+
+namespace gbm {
+
+// Sequential part of a tick: price update, bid/ask and invariants.
+// Kept scalar so repeated symbols inside one burst evolve in order.
+inline void ApplyLane(SymbolStore& st, TickBurst& out, size_t i, const LaneDraw& d) {
+    const uint16_t id = out.symbol[i];
+
+    double price = st.price[id] * d.growth;
+    // Safety guard (prices should never go negative)
+    price = price < 0.01 ? 0.01 : price;
+
+    double bid = price * (1.0 - st.half_spread[id]);
+    double ask = price * (1.0 + st.half_spread[id]);
+    // Safety invariant
+    if (bid >= ask) {
+        bid = price * 0.999;
+        ask = price * 1.001;
+    }
+    st.price[id] = price;
+    st.bid[id]   = bid;
+    st.ask[id]   = ask;
+
+    out.bid[i]           = bid;
+    out.ask[i]           = ask;
+    out.bid_qty[i]       = static_cast<uint32_t>(d.bid_qty);
+    out.ask_qty[i]       = static_cast<uint32_t>(d.ask_qty);
+    out.trade_qty[i]     = d.trade_qty;
+    out.aggressor_buy[i] = static_cast<uint8_t>(d.aggressor_buy);
+}
+
+// Scalar reference path: one tick at a time
+inline void EvolveScalar(SymbolStore& st, const uint16_t* ids, size_t n, TickBurst& out) {
+    out.count = n;
+    for (size_t i = 0; i < n; ++i) {
+        const uint16_t id = ids[i];
+        out.symbol[i] = id;
+        const LaneDraw d = DrawLane(st.draw_counter[id]++, id, st.key0, st.key1,
+                                    st.drift_dt[id], st.vol_sqrt_dt[id]);
+        ApplyLane(st, out, i, d);
+    }
+}
+
+// Batched path: gather, draw GBM_LANES ticks with SIMD-friendly loops, apply in order
+inline void EvolveBatch(SymbolStore& st, const uint16_t* ids, size_t n, TickBurst& out) {
+    out.count = n;
+    for (size_t base = 0; base < n; base += GBM_LANES) {
+        const size_t lanes = std::min(GBM_LANES, n - base);
+
+        uint64_t counter[GBM_LANES] = {};
+        uint16_t symbol[GBM_LANES]  = {};
+        double drift[GBM_LANES]     = {};
+        double vol[GBM_LANES]       = {};
+
+        // gather (scalar: counters must advance in tick order for repeated symbols)
+        for (size_t i = 0; i < lanes; ++i) {
+            const uint16_t id = ids[base + i];
+            out.symbol[base + i] = id;
+            symbol[i]  = id;
+            counter[i] = st.draw_counter[id]++;
+            drift[i]   = st.drift_dt[id];
+            vol[i]     = st.vol_sqrt_dt[id];
+        }
+
+        // draw: stage by stage, fixed trip count, no cross-lane dependencies
+        uint32_t w0[GBM_LANES], w1[GBM_LANES], w2[GBM_LANES], w3[GBM_LANES];
+        PhiloxLanes(counter, symbol, st.key0, st.key1, w0, w1, w2, w3);
+
+        double z0[GBM_LANES], z1[GBM_LANES], z2[GBM_LANES];
+        for (size_t i = 0; i < GBM_LANES; ++i) {
+            const double r01 = std::sqrt(-2.0 * FastLog(ToOpenUniform(w0[i])));
+            const double r23 = std::sqrt(-2.0 * FastLog(ToOpenUniform(w2[i])));
+            double s01, c01, s23, c23;
+            SinCos2Pi(w1[i], s01, c01);
+            SinCos2Pi(w3[i], s23, c23);
+            z0[i] = r01 * c01;
+            z1[i] = r01 * s01;
+            z2[i] = r23 * c23;
+        }
+
+        LaneDraw draws[GBM_LANES];
+        for (size_t i = 0; i < GBM_LANES; ++i) {
+            draws[i] = FinishLane(w2[i], w3[i], z0[i], z1[i], z2[i], drift[i], vol[i]);
+        }
+
+        for (size_t i = 0; i < lanes; ++i) {
+            ApplyLane(st, out, base + i, draws[i]);
+        }
+    }
+}
+
+} // namespace gbm
+
+#endif
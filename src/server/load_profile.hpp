@@ -0,0 +1,87 @@
+#ifndef LOAD_PROFILE_HPP
+#define LOAD_PROFILE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+// Target tick rate as a function of time since the profile started.
+//   CONSTANT  base_rate
+//   STEP      staircase from rate_min to rate_max in `steps` equal steps per period
+//   SINE      oscillates between rate_min and rate_max once per period
+//   BURST     base_rate, times burst_multiplier for the first burst_ns of every period
+// On top of any shape a one-off spike (SPIKE on the control port) multiplies
+// the rate until it expires. The shape is clamped to [rate_min, rate_max];
+// bursts and spikes multiply that and may go up to rate_peak.
+// Pure function of its inputs: evaluated by the network thread only.
+enum class LoadShape : uint8_t { CONSTANT, STEP, SINE, BURST };
+
+struct LoadProfile {
+    LoadShape shape{LoadShape::CONSTANT};
+    uint32_t base_rate{50000};
+    uint32_t rate_min{10000};
+    uint32_t rate_max{500000};
+    uint32_t rate_peak{5000000};    // ceiling of bursts and spikes, >= rate_max
+    uint64_t period_ns{10'000'000'000ULL};
+    uint32_t steps{5};
+    uint32_t burst_multiplier{10};
+    uint64_t burst_ns{500'000'000ULL};
+
+    uint32_t spike_multiplier{1};
+    uint64_t spike_until_ns{0};     // elapsed time the spike ends at
+
+    uint32_t rate_at(uint64_t elapsed_ns) const {
+        const uint64_t phase = period_ns ? elapsed_ns % period_ns : 0;
+        double rate = base_rate;
+        double multiplier = 1.0;
+
+        switch (shape) {
+            case LoadShape::CONSTANT:
+                break;
+            case LoadShape::STEP: {
+                const uint32_t n = std::max<uint32_t>(steps, 2);
+                const uint64_t step = std::min<uint64_t>(phase * n / std::max<uint64_t>(period_ns, 1), n - 1);
+                rate = rate_min + static_cast<double>(rate_max - rate_min) * step / (n - 1);
+                break;
+            }
+            case LoadShape::SINE: {
+                const double mid = 0.5 * (static_cast<double>(rate_max) + rate_min);
+                const double amp = 0.5 * (static_cast<double>(rate_max) - rate_min);
+                rate = mid + amp * std::sin(2.0 * M_PI * static_cast<double>(phase) / std::max<uint64_t>(period_ns, 1));
+                break;
+            }
+            case LoadShape::BURST:
+                if (phase < burst_ns) {
+                    multiplier = burst_multiplier;
+                }
+                break;
+        }
+        if (elapsed_ns < spike_until_ns) {
+            multiplier *= spike_multiplier;
+        }
+        rate = std::clamp(rate, static_cast<double>(rate_min), static_cast<double>(rate_max)) * multiplier;
+        return static_cast<uint32_t>(std::clamp(rate, static_cast<double>(rate_min),
+                                                static_cast<double>(std::max(rate_peak, rate_max))));
+    }
+
+    static bool parse_shape(const std::string& name, LoadShape& out) {
+        if (name == "CONSTANT") out = LoadShape::CONSTANT;
+        else if (name == "STEP") out = LoadShape::STEP;
+        else if (name == "SINE") out = LoadShape::SINE;
+        else if (name == "BURST") out = LoadShape::BURST;
+        else return false;
+        return true;
+    }
+
+    static const char* shape_name(LoadShape shape) {
+        switch (shape) {
+            case LoadShape::STEP:  return "STEP";
+            case LoadShape::SINE:  return "SINE";
+            case LoadShape::BURST: return "BURST";
+            default:               return "CONSTANT";
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef MULTICAST_PUBLISHER_HPP
+#define MULTICAST_PUBLISHER_HPP
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "../common/protocol.hpp"
+
+// UDP multicast distribution: every tick is encoded once as a v2 frame and
+// packed into MTU sized datagrams, which are sent to the group with a
+// single sendmmsg() per flush. The cost is the same whatever the number of
+// receivers. Network thread only.
+class MulticastPublisher {
+public:
+    static constexpr size_t MAX_PACKET  = 1472;   // 1500 byte MTU minus IP and UDP headers
+    static constexpr size_t MAX_PENDING = 32;     // datagrams per sendmmsg()
+
+    MulticastPublisher() = default;
+    MulticastPublisher(const MulticastPublisher&) = delete;
+    MulticastPublisher& operator=(const MulticastPublisher&) = delete;
+
+    ~MulticastPublisher() { close(); }
+
+    // iface: local address the group is sent from, e.g. 127.0.0.1 to keep
+    // the feed on loopback. ttl 0 keeps it on the host.
+    bool open(const std::string& group, uint16_t port, const std::string& iface, int ttl) {
+        m_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        if (m_fd < 0) {
+            perror("multicast socket ");
+            return false;
+        }
+
+        m_dest = sockaddr_in{};
+        m_dest.sin_family = AF_INET;
+        m_dest.sin_port   = htons(port);
+        if (inet_pton(AF_INET, group.c_str(), &m_dest.sin_addr) != 1 ||
+            !IN_MULTICAST(ntohl(m_dest.sin_addr.s_addr))) {
+            std::fprintf(stderr, "multicast: %s is not a multicast group\n", group.c_str());
+            close();
+            return false;
+        }
+
+        in_addr local{};
+        local.s_addr = INADDR_ANY;
+        if (!iface.empty() && inet_pton(AF_INET, iface.c_str(), &local) != 1) {
+            std::fprintf(stderr, "multicast: bad interface address %s\n", iface.c_str());
+            close();
+            return false;
+        }
+
+        const unsigned char loop = 1;   // receivers on this host must see it too
+        const unsigned char hops = static_cast<unsigned char>(ttl);
+        int sndbuf = 4 * 1024 * 1024;
+        if (setsockopt(m_fd, IPPROTO_IP, IP_MULTICAST_IF, &local, sizeof(local)) < 0 ||
+            setsockopt(m_fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0 ||
+            setsockopt(m_fd, IPPROTO_IP, IP_MULTICAST_TTL, &hops, sizeof(hops)) < 0) {
+            perror("multicast setsockopt ");
+            close();
+            return false;
+        }
+        setsockopt(m_fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+        return true;
+    }
+
+    bool is_open() const { return m_fd >= 0; }
+
+    void close() {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    // Appends one encoded v2 frame; frames never straddle datagrams.
+    // Sends on its own once MAX_PENDING datagrams are full.
+    void publish(const uint8_t* frame, size_t len) {
+        if (m_len[m_open] + len > MAX_PACKET) {
+            ++m_open;
+            if (m_open == MAX_PENDING) {
+                flush();
+            }
+        }
+        if (m_len[m_open] == 0) {
+            m_len[m_open] = sizeof(v2::PacketHeader);   // header written at flush
+        }
+        std::memcpy(m_packets[m_open].data() + m_len[m_open], frame, len);
+        m_len[m_open] += len;
+        ++m_count[m_open];
+    }
+
+    // Stamps and sends every pending datagram. Whatever the socket does not
+    // take is dropped: the packet sequence still advances, so receivers
+    // see the gap and recover over TCP.
+    void flush() {
+        const size_t pending = m_len[m_open] != 0 ? m_open + 1 : m_open;
+        if (pending == 0) {
+            return;
+        }
+
+        const uint64_t now = steady_ns();
+        mmsghdr msgs[MAX_PENDING];
+        iovec iov[MAX_PENDING];
+        for (size_t i = 0; i < pending; ++i) {
+            v2::PacketHeader h;
+            h.packet_sequence   = htole64(m_next_sequence++);
+            h.send_timestamp_ns = htole64(now);
+            h.count             = htole16(m_count[i]);
+            std::memcpy(m_packets[i].data(), &h, sizeof(h));
+
+            iov[i].iov_base = m_packets[i].data();
+            iov[i].iov_len  = m_len[i];
+            msgs[i] = mmsghdr{};
+            msgs[i].msg_hdr.msg_name    = &m_dest;
+            msgs[i].msg_hdr.msg_namelen = sizeof(m_dest);
+            msgs[i].msg_hdr.msg_iov     = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen  = 1;
+        }
+
+        int sent = sendmmsg(m_fd, msgs, static_cast<unsigned>(pending), 0);
+        if (sent < 0) {
+            sent = 0;
+        }
+        m_packets_sent    += static_cast<uint64_t>(sent);
+        m_packets_dropped += pending - static_cast<size_t>(sent);
+
+        for (size_t i = 0; i < pending; ++i) {
+            m_len[i]   = 0;
+            m_count[i] = 0;
+        }
+        m_open = 0;
+    }
+
+    uint64_t packets_sent() const { return m_packets_sent; }
+    uint64_t packets_dropped() const { return m_packets_dropped; }
+
+private:
+    // Same clock as the tick timestamps
+    static uint64_t steady_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    int m_fd{-1};
+    sockaddr_in m_dest{};
+
+    std::array<std::array<uint8_t, MAX_PACKET>, MAX_PENDING> m_packets;
+    std::array<size_t, MAX_PENDING> m_len{};       // 0 = datagram not started
+    std::array<uint16_t, MAX_PENDING> m_count{};
+    size_t m_open{0};                               // datagram being filled
+
+    uint64_t m_next_sequence{1};
+    uint64_t m_packets_sent{0};
+    uint64_t m_packets_dropped{0};
+};
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef OUTBOUND_BUFFER_HPP
+#define OUTBOUND_BUFFER_HPP
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <vector>
+#include "wire_slab.hpp"
+
+// Per-client queue of references into shared wire slabs that the tick loop
+// fills and the event loop drains. Enqueueing a message is a pointer push;
+// a flush gathers the pending references (adjacent ones coalesced into one
+// iovec) and pushes them to the socket with a single sendmsg().
+class OutboundBuffer {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 20;   // pending bytes before the client is dropped
+    static constexpr size_t MAX_IOV = 256;
+
+    OutboundBuffer() : OutboundBuffer(DEFAULT_CAPACITY) {}
+
+    explicit OutboundBuffer(size_t capacity)
+        : m_capacity(capacity), m_refs(4096), m_mask(4096 - 1) {}
+
+    OutboundBuffer(const OutboundBuffer&) = delete;
+    OutboundBuffer& operator=(const OutboundBuffer&) = delete;
+
+    ~OutboundBuffer() {
+        while (m_head != m_tail) {
+            pop_front();
+        }
+    }
+
+    size_t pending() const { return m_pending_bytes; }
+    size_t capacity() const { return m_capacity; }
+    void set_capacity(size_t capacity) { m_capacity = capacity; }
+
+    // The last flush filled the socket: wait for EPOLLOUT before the next
+    bool would_block() const { return m_would_block; }
+    size_t free_space() const { return m_capacity - m_pending_bytes; }
+    bool empty() const { return m_head == m_tail; }
+
+    // Returns false (and queues nothing) if the message does not fit.
+    bool append(const WireRef& ref) {
+        if (ref.len > free_space()) {
+            return false;
+        }
+        if (m_tail - m_head == m_refs.size()) {
+            grow();
+        }
+        SlabPool::retain(ref);
+        m_refs[m_tail & m_mask] = ref;
+        ++m_tail;
+        m_pending_bytes += ref.len;
+        return true;
+    }
+
+    // Reserves an empty slot for a header that is only known once the
+    // messages queued behind it are complete (batch frames). Must be
+    // filled before the next flush.
+    uint64_t reserve() {
+        if (m_tail - m_head == m_refs.size()) {
+            grow();
+        }
+        m_refs[m_tail & m_mask] = WireRef{nullptr, 0, 0};
+        return m_tail++;
+    }
+
+    // Fills a reserved slot; may exceed capacity by the header size
+    void fill(uint64_t position, const WireRef& ref) {
+        SlabPool::retain(ref);
+        m_refs[position & m_mask] = ref;
+        m_pending_bytes += ref.len;
+    }
+
+    // Sends as much as the socket accepts without blocking, at most
+    // max_bytes (fault injection cuts sends short with it).
+    // Returns bytes sent (0 on EAGAIN) or -1 on a fatal socket error.
+    ssize_t flush(int fd, size_t max_bytes = SIZE_MAX) {
+        m_would_block = false;
+        if (empty() || max_bytes == 0) {
+            return 0;
+        }
+
+        iovec iov[MAX_IOV];
+        size_t iovcnt = 0;
+        for (uint64_t i = m_head; i != m_tail; ++i) {
+            const WireRef& ref = m_refs[i & m_mask];
+            if (ref.slab == nullptr) {
+                break;   // reservation not filled yet
+            }
+            const uint8_t* bytes = ref.bytes();
+            if (iovcnt > 0 &&
+                static_cast<uint8_t*>(iov[iovcnt - 1].iov_base) + iov[iovcnt - 1].iov_len == bytes) {
+                iov[iovcnt - 1].iov_len += ref.len;
+                continue;
+            }
+            if (iovcnt == MAX_IOV) {
+                break;
+            }
+            iov[iovcnt].iov_base = const_cast<uint8_t*>(bytes);
+            iov[iovcnt].iov_len  = ref.len;
+            ++iovcnt;
+        }
+
+        if (max_bytes != SIZE_MAX) {
+            size_t total = 0;
+            for (size_t i = 0; i < iovcnt; ++i) {
+                if (total + iov[i].iov_len >= max_bytes) {
+                    iov[i].iov_len = max_bytes - total;
+                    iovcnt = i + 1;
+                    break;
+                }
+                total += iov[i].iov_len;
+            }
+        }
+
+        size_t attempted = 0;
+        for (size_t i = 0; i < iovcnt; ++i) {
+            attempted += iov[i].iov_len;
+        }
+
+        msghdr mh{};
+        mh.msg_iov    = iov;
+        mh.msg_iovlen = iovcnt;
+
+        ssize_t sent = sendmsg(fd, &mh, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                m_would_block = true;
+                return 0;
+            }
+            if (errno == EINTR) {
+                return 0;
+            }
+            return -1;
+        }
+        // A short write means the socket buffer is full
+        m_would_block = static_cast<size_t>(sent) < attempted;
+        consume(static_cast<size_t>(sent));
+        return sent;
+    }
+
+private:
+    void consume(size_t bytes) {
+        m_pending_bytes -= bytes;
+        while (bytes > 0) {
+            WireRef& front = m_refs[m_head & m_mask];
+            if (bytes < front.len) {
+                // Short write inside a message: resume from the middle next time
+                front.offset += static_cast<uint32_t>(bytes);
+                front.len    -= static_cast<uint32_t>(bytes);
+                return;
+            }
+            bytes -= front.len;
+            pop_front();
+        }
+    }
+
+    void pop_front() {
+        WireSlab* slab = m_refs[m_head & m_mask].slab;
+        if (slab != nullptr) {   // unfilled reservation
+            SlabPool::release(slab);
+        }
+        ++m_head;
+    }
+
+    // Positions stay valid across a grow (reserve() hands them out)
+    void grow() {
+        std::vector<WireRef> bigger(m_refs.size() * 2);
+        const size_t mask = bigger.size() - 1;
+        for (uint64_t i = m_head; i != m_tail; ++i) {
+            bigger[i & mask] = m_refs[i & m_mask];
+        }
+        m_refs.swap(bigger);
+        m_mask = mask;
+    }
+
+    size_t m_capacity;
+    size_t m_pending_bytes{0};
+    bool m_would_block{false};
+    std::vector<WireRef> m_refs;   // power-of-two ring
+    size_t m_mask;
+    uint64_t m_head{0};   // next reference to send
+    uint64_t m_tail{0};   // next free slot
+};
+
+#endif
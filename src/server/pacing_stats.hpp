@@ -0,0 +1,83 @@
+#ifndef PACING_STATS_HPP
+#define PACING_STATS_HPP
+
+#include <array>
+#include <cstdint>
+
+// Tick emission jitter: how late each tick left its worker relative to its
+// scheduled slot. Log-linear buckets (8 per power of two, ~12% wide) up to
+// 2^64 ns. Written by one worker, read after the worker has been joined.
+class PacingStats {
+public:
+    static constexpr size_t SUB_BUCKETS = 8;
+    static constexpr size_t BUCKETS = (64 - 2) * SUB_BUCKETS;
+
+    void record(uint64_t late_ns) {
+        ++m_counts[bucket_of(late_ns)];
+        ++m_count;
+        m_sum += late_ns;
+        if (late_ns > m_max) {
+            m_max = late_ns;
+        }
+    }
+
+    void merge(const PacingStats& other) {
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            m_counts[i] += other.m_counts[i];
+        }
+        m_count += other.m_count;
+        m_sum   += other.m_sum;
+        if (other.m_max > m_max) {
+            m_max = other.m_max;
+        }
+    }
+
+    uint64_t count() const { return m_count; }
+    uint64_t max() const { return m_max; }
+    double mean() const { return m_count ? static_cast<double>(m_sum) / m_count : 0.0; }
+
+    // Upper bound of the bucket holding quantile q (0..1)
+    uint64_t quantile(double q) const {
+        if (m_count == 0) {
+            return 0;
+        }
+        const uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(m_count - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += m_counts[i];
+            if (seen >= rank) {
+                const uint64_t bound = upper_bound_of(i);
+                return bound < m_max ? bound : m_max;
+            }
+        }
+        return m_max;
+    }
+
+    static size_t bucket_of(uint64_t v) {
+        if (v < SUB_BUCKETS) {
+            return static_cast<size_t>(v);
+        }
+        const unsigned msb = 63 - __builtin_clzll(v);
+        return (msb - 2) * SUB_BUCKETS + ((v >> (msb - 3)) & (SUB_BUCKETS - 1));
+    }
+
+    static uint64_t upper_bound_of(size_t bucket) {
+        if (bucket < SUB_BUCKETS) {
+            return bucket;
+        }
+        const unsigned msb = static_cast<unsigned>(bucket / SUB_BUCKETS) + 2;
+        const uint64_t sub = bucket % SUB_BUCKETS;
+        if (msb == 63 && sub == SUB_BUCKETS - 1) {
+            return ~0ULL;
+        }
+        return ((SUB_BUCKETS + sub + 1) << (msb - 3)) - 1;
+    }
+
+private:
+    std::array<uint64_t, BUCKETS> m_counts{};
+    uint64_t m_count{0};
+    uint64_t m_sum{0};
+    uint64_t m_max{0};
+};
+
+#endif
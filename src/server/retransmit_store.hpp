@@ -0,0 +1,60 @@
+#ifndef RETRANSMIT_STORE_HPP
+#define RETRANSMIT_STORE_HPP
+
+#include <cstdint>
+#include <vector>
+#include <endian.h>
+#include "ConfigManager.hpp"
+#include "../common/protocol.hpp"
+
+// Most recent `depth` encoded messages of every symbol, for gap recovery.
+// Each symbol has its own power-of-two ring indexed by sequence number, so a
+// lookup is one slot check: a slot holds sequence s only if it was the last
+// message written there. Messages are kept in wire format and replayed as-is.
+// Network thread only.
+class RetransmitStore {
+public:
+    explicit RetransmitStore(size_t depth_pow2 = 1024)
+        : m_depth(depth_pow2),
+          m_mask(depth_pow2 - 1),
+          m_slots((MAX_SYMBOL_ID + 1) * depth_pow2) {}
+
+    RetransmitStore(const RetransmitStore&) = delete;
+    RetransmitStore& operator=(const RetransmitStore&) = delete;
+
+    void record(uint16_t symbol, uint64_t sequence, const MarketMessage& wire) {
+        m_slots[symbol * m_depth + (sequence & m_mask)] = wire;
+    }
+
+    // fn(const MarketMessage& wire) for every stored message of symbol in
+    // [from, to], oldest first; returns how many were found. Ranges longer
+    // than the ring are clipped to the newest `depth` sequences.
+    template <typename Fn>
+    size_t replay(uint16_t symbol, uint64_t from, uint64_t to, Fn&& fn) const {
+        if (symbol > MAX_SYMBOL_ID || from == 0 || to < from) {
+            return 0;
+        }
+        if (to - from >= m_depth) {
+            from = to - m_depth + 1;
+        }
+        const MarketMessage* ring = &m_slots[symbol * m_depth];
+        size_t found = 0;
+        for (uint64_t seq = from; seq <= to; ++seq) {
+            const MarketMessage& wire = ring[seq & m_mask];
+            if (be64toh(wire.sequence) == seq) {
+                fn(wire);
+                ++found;
+            }
+        }
+        return found;
+    }
+
+    size_t depth() const { return m_depth; }
+
+private:
+    size_t m_depth;
+    size_t m_mask;
+    std::vector<MarketMessage> m_slots;   // [symbol][sequence & mask]
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Bounded single-producer / single-consumer ring.
+// Head and tail live on separate cache lines; each side keeps a cached copy
+// of the other's index so the shared line is only touched when the cache
+// says the queue looks full (producer) or empty (consumer).
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity_pow2)
+        : m_slots(new T[capacity_pow2]), m_mask(capacity_pow2 - 1) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer side
+    bool try_push(const T& item) {
+        const uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head_cache > m_mask) {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+            if (tail - m_head_cache > m_mask) {
+                return false;
+            }
+        }
+        m_slots[tail & m_mask] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: hands up to max_items to fn(const T&), returns the count
+    template <typename Fn>
+    size_t consume(Fn&& fn, size_t max_items) {
+        const uint64_t head = m_head.load(std::memory_order_relaxed);
+        if (m_tail_cache == head) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            if (m_tail_cache == head) {
+                return 0;
+            }
+        }
+        size_t n = static_cast<size_t>(m_tail_cache - head);
+        if (n > max_items) {
+            n = max_items;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            fn(m_slots[(head + i) & m_mask]);
+        }
+        m_head.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+    // Items queued right now; only a snapshot when read off the owning threads
+    size_t size_approx() const {
+        return static_cast<size_t>(m_tail.load(std::memory_order_relaxed) -
+                                   m_head.load(std::memory_order_relaxed));
+    }
+
+private:
+    std::unique_ptr<T[]> m_slots;
+    const size_t m_mask;
+
+    alignas(64) std::atomic<uint64_t> m_head{0};   // written by consumer
+    uint64_t m_tail_cache{0};                      // consumer's view of tail
+
+    alignas(64) std::atomic<uint64_t> m_tail{0};   // written by producer
+    uint64_t m_head_cache{0};                      // producer's view of head
+};
+
+#endif
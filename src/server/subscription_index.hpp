@@ -0,0 +1,81 @@
+#ifndef SUBSCRIPTION_INDEX_HPP
+#define SUBSCRIPTION_INDEX_HPP
+
+#include <array>
+#include <cstdint>
+#include "ConfigManager.hpp"
+
+// Inverted subscription index: for every symbol id a bitmap of the client
+// slots subscribed to it. Fan-out walks the set bits of one symbol only, so
+// the cost per tick is proportional to the number of interested clients.
+class SubscriptionIndex {
+public:
+    static constexpr size_t MAX_CLIENTS = 256;
+    static constexpr size_t WORDS = MAX_CLIENTS / 64;
+
+    SubscriptionIndex() {
+        for (auto& words : m_bits) {
+            words.fill(0);
+        }
+        m_used_slots.fill(0);
+    }
+
+    // Returns a free client slot, or -1 when MAX_CLIENTS are connected
+    int acquire_slot() {
+        for (size_t w = 0; w < WORDS; ++w) {
+            if (m_used_slots[w] != ~0ULL) {
+                const int bit = __builtin_ctzll(~m_used_slots[w]);
+                m_used_slots[w] |= 1ULL << bit;
+                return static_cast<int>(w * 64 + bit);
+            }
+        }
+        return -1;
+    }
+
+    // Frees the slot and drops it from every symbol
+    void release_slot(int slot) {
+        const size_t w = slot / 64;
+        const uint64_t mask = ~(1ULL << (slot % 64));
+        for (auto& words : m_bits) {
+            words[w] &= mask;
+        }
+        m_used_slots[w] &= mask;
+    }
+
+    void subscribe(uint16_t symbol, int slot) {
+        m_bits[symbol][slot / 64] |= 1ULL << (slot % 64);
+    }
+
+    void unsubscribe(uint16_t symbol, int slot) {
+        m_bits[symbol][slot / 64] &= ~(1ULL << (slot % 64));
+    }
+
+    bool has_subscribers(uint16_t symbol) const {
+        const auto& words = m_bits[symbol];
+        uint64_t any = 0;
+        for (size_t w = 0; w < WORDS; ++w) {
+            any |= words[w];
+        }
+        return any != 0;
+    }
+
+    // fn(int slot) for every client subscribed to symbol
+    template <typename Fn>
+    void for_each_subscriber(uint16_t symbol, Fn&& fn) const {
+        const auto& words = m_bits[symbol];
+        for (size_t w = 0; w < WORDS; ++w) {
+            uint64_t bits = words[w];
+            while (bits != 0) {
+                const int bit = __builtin_ctzll(bits);
+                bits &= bits - 1;
+                fn(static_cast<int>(w * 64 + bit));
+            }
+        }
+    }
+
+private:
+    std::array<std::array<uint64_t, WORDS>, MAX_SYMBOL_ID + 1> m_bits;
+    std::array<uint64_t, WORDS> m_used_slots;
+};
+
+#endif
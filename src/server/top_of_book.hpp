@@ -0,0 +1,70 @@
+#ifndef TOP_OF_BOOK_HPP
+#define TOP_OF_BOOK_HPP
+
+#include <array>
+#include <cstdint>
+#include "ConfigManager.hpp"
+#include "../common/protocol.hpp"
+
+// Top of book per symbol as the network thread last broadcast it, for
+// snapshots to clients that just subscribed. The workers own SymbolStore
+// and keep moving it; this copy only changes when a tick is broadcast, so
+// it needs no synchronisation and its sequence is exactly where the
+// client's live stream for the symbol continues. Network thread only,
+// apart from seed() before the workers start.
+class TopOfBookTable {
+public:
+    struct Entry {
+        double bid_price{0.0};
+        double ask_price{0.0};
+        uint32_t bid_qty{0};
+        uint32_t ask_qty{0};
+        uint64_t sequence{0};       // last sequence broadcast for the symbol, any type
+        uint64_t timestamp_ns{0};   // of the quote the prices come from
+        bool active{false};
+    };
+
+    // Opening prices of an active symbol; sequence 0 = nothing sent yet
+    void seed(uint16_t symbol, double bid, double ask, uint64_t timestamp_ns) {
+        Entry& e = m_entries[symbol];
+        e.bid_price    = bid;
+        e.ask_price    = ask;
+        e.timestamp_ns = timestamp_ns;
+        e.active       = true;
+    }
+
+    void on_broadcast(const MarketMessage& msg) {
+        Entry& e = m_entries[msg.symbol_id];
+        e.sequence = msg.sequence;
+        if (msg.type == MessageType::QUOTE) {
+            e.bid_price    = msg.quote.bid_price;
+            e.ask_price    = msg.quote.ask_price;
+            e.bid_qty      = msg.quote.bid_qty;
+            e.ask_qty      = msg.quote.ask_qty;
+            e.timestamp_ns = msg.timestamp_ns;
+        }
+    }
+
+    // SNAPSHOT message for symbol; false if the simulator does not trade it
+    bool snapshot(uint16_t symbol, MarketMessage& out) const {
+        const Entry& e = m_entries[symbol];
+        if (!e.active) {
+            return false;
+        }
+        out = MarketMessage{};
+        out.type             = MessageType::SNAPSHOT;
+        out.symbol_id        = symbol;
+        out.sequence         = e.sequence;
+        out.timestamp_ns     = e.timestamp_ns;
+        out.quote.bid_price  = e.bid_price;
+        out.quote.ask_price  = e.ask_price;
+        out.quote.bid_qty    = e.bid_qty;
+        out.quote.ask_qty    = e.ask_qty;
+        return true;
+    }
+
+private:
+    std::array<Entry, MAX_SYMBOL_ID + 1> m_entries{};
+};
+
+#endif
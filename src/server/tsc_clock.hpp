@@ -0,0 +1,129 @@
+#ifndef TSC_CLOCK_HPP
+#define TSC_CLOCK_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define TSC_CLOCK_HAVE_RDTSC 1
+#endif
+
+// 64 x 32 bit products of the fixed-point scale overflow 64 bits
+__extension__ typedef unsigned __int128 tsc_u128;
+
+// steady_clock compatible nanoseconds from rdtsc, for loops that read the
+// time once per tick. Timestamps have to stay comparable with the feed
+// handler's steady_clock, so the clock is anchored to steady_clock and its
+// rate is refined against it every RECALIBRATE_NS. The first estimate
+// comes from a short calibration window. Without an invariant TSC it
+// reads steady_clock directly.
+// One instance per thread: nothing here is shared or atomic.
+class TscClock {
+public:
+    static constexpr uint64_t CALIBRATE_NS   = 10'000'000;    // initial window
+    static constexpr uint64_t RECALIBRATE_NS = 100'000'000;   // re-anchor period
+
+    static uint64_t steady_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Constant rate across P-states and C-states (CPUID 0x80000007 EDX bit 8)
+    static bool invariant_tsc() {
+#ifdef TSC_CLOCK_HAVE_RDTSC
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+            return false;
+        }
+        return (edx & (1u << 8)) != 0;
+#else
+        return false;
+#endif
+    }
+
+    // Blocks for CALIBRATE_NS. Returns false if rdtsc is not usable, in
+    // which case now_ns() falls back to steady_clock.
+    bool calibrate() {
+#ifdef TSC_CLOCK_HAVE_RDTSC
+        m_use_tsc = invariant_tsc();
+        if (!m_use_tsc) {
+            return false;
+        }
+        m_start_ns  = steady_ns();
+        m_start_tsc = __rdtsc();
+        std::this_thread::sleep_for(std::chrono::nanoseconds(CALIBRATE_NS));
+        reanchor(__rdtsc());
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool uses_tsc() const { return m_use_tsc; }
+
+    // Nanoseconds per TSC tick as measured so far (0 without TSC)
+    double ns_per_tick() const {
+        return m_use_tsc ? static_cast<double>(m_mult) / 4294967296.0 : 0.0;
+    }
+
+    uint64_t now_ns() {
+#ifdef TSC_CLOCK_HAVE_RDTSC
+        if (m_use_tsc) {
+            const uint64_t tsc = __rdtsc();
+            if (tsc - m_base_tsc >= m_reanchor_ticks) {
+                reanchor(tsc);
+            }
+            const uint64_t ns = m_base_ns + static_cast<uint64_t>(
+                (static_cast<tsc_u128>(tsc - m_base_tsc) * m_mult) >> 32);
+            // Re-anchoring may pull the clock back by the estimate's error
+            if (ns > m_last_ns) {
+                m_last_ns = ns;
+            }
+            return m_last_ns;
+        }
+#endif
+        return steady_ns();
+    }
+
+    // Spin-wait hint
+    static void relax() {
+#ifdef TSC_CLOCK_HAVE_RDTSC
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+private:
+#ifdef TSC_CLOCK_HAVE_RDTSC
+    // Rate over everything observed since calibrate(), so it only gets more
+    // accurate; the offset is reset to steady_clock each time
+    void reanchor(uint64_t tsc) {
+        const uint64_t ns = steady_ns();
+        const uint64_t elapsed_ticks = tsc - m_start_tsc;
+        if (elapsed_ticks != 0) {
+            m_mult = static_cast<uint64_t>(
+                (static_cast<tsc_u128>(ns - m_start_ns) << 32) / elapsed_ticks);
+        }
+        m_base_ns  = ns;
+        m_base_tsc = tsc;
+        m_reanchor_ticks = m_mult != 0
+            ? static_cast<uint64_t>((static_cast<tsc_u128>(RECALIBRATE_NS) << 32) / m_mult)
+            : 1;
+    }
+#endif
+
+    bool m_use_tsc{false};
+    uint64_t m_start_ns{0};
+    uint64_t m_start_tsc{0};
+    uint64_t m_base_ns{0};
+    uint64_t m_base_tsc{0};
+    uint64_t m_mult{0};             // ns per tick, 32.32 fixed point
+    uint64_t m_reanchor_ticks{1};
+    uint64_t m_last_ns{0};
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef WIRE_SLAB_HPP
+#define WIRE_SLAB_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Encoded messages are written once into a shared slab and every subscribed
+// client queues a WireRef into it. The slab is recycled when the last
+// reference has been sent. Network thread only: the refcount is not atomic.
+class SlabPool;
+
+struct WireSlab {
+    static constexpr uint32_t SLAB_BYTES = 64 * 1024;
+
+    SlabPool* owner{nullptr};
+    uint32_t used{0};
+    uint32_t refs{0};
+    alignas(64) uint8_t data[SLAB_BYTES];
+};
+
+struct WireRef {
+    WireSlab* slab;
+    uint32_t offset;
+    uint32_t len;
+
+    const uint8_t* bytes() const { return slab->data + offset; }
+};
+
+class SlabPool {
+public:
+    SlabPool() = default;
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    // Copies len bytes into the current slab and returns a reference with
+    // refs == 0; callers retain() once per queue that holds it.
+    WireRef store(const void* bytes, uint32_t len) {
+        if (m_current == nullptr || m_current->used + len > WireSlab::SLAB_BYTES) {
+            rotate();
+        }
+        WireRef ref{m_current, m_current->used, len};
+        std::memcpy(m_current->data + m_current->used, bytes, len);
+        m_current->used += len;
+        return ref;
+    }
+
+    static void retain(const WireRef& ref) { ++ref.slab->refs; }
+
+    static void release(WireSlab* slab) {
+        if (--slab->refs == 0) {
+            slab->owner->recycle(slab);
+        }
+    }
+
+    size_t slabs_allocated() const { return m_all.size(); }
+
+private:
+    // The pool holds one reference on the slab being filled so it is not
+    // recycled while messages are still being appended to it.
+    void rotate() {
+        if (m_current != nullptr) {
+            release(m_current);
+        }
+        if (m_free.empty()) {
+            m_all.push_back(std::make_unique<WireSlab>());
+            m_all.back()->owner = this;
+            m_free.push_back(m_all.back().get());
+        }
+        m_current = m_free.back();
+        m_free.pop_back();
+        m_current->used = 0;
+        m_current->refs = 1;
+    }
+
+    void recycle(WireSlab* slab) { m_free.push_back(slab); }
+
+    std::vector<std::unique_ptr<WireSlab>> m_all;
+    std::vector<WireSlab*> m_free;
+    WireSlab* m_current{nullptr};
+};
+
+#endif
@@ -0,0 +1,323 @@
+#include "feed_handler.hpp"
+#include "test_check.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <memory>
+
+// Gap recovery of an offline FeedHandler. Live ticks go through
+// check_sequence() and on_message() like the socket path; the retransmit
+// port is a loopback listener whose replies the test writes by hand.
+struct FeedHandlerTest {
+    std::unique_ptr<FeedHandler> fh{new FeedHandler()};
+    int epoll_fd{-1};
+    int listen_fd{-1};
+    int server_fd{-1};   // the recovery connection, accepted on first use
+
+    FeedHandlerTest() {
+        epoll_fd  = epoll_create1(0);
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (epoll_fd < 0 || listen_fd < 0 ||
+            bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), len) < 0 ||
+            listen(listen_fd, 1) < 0 ||
+            getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &len) < 0) {
+            perror("recovery listener");
+        }
+
+        FeedHandler& h = *fh;
+        h.epoll_fd_ = epoll_fd;
+        h.recovery_.configure("127.0.0.1", ntohs(addr.sin_port), epoll_fd,
+                              [&h](const MarketMessage& msg) { h.on_replay(msg); },
+                              [&h](uint16_t symbol) { h.on_range_end(symbol); });
+    }
+
+    ~FeedHandlerTest() {
+        fh.reset();
+        for (int fd : {server_fd, listen_fd, epoll_fd}) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    static MarketMessage quote(uint16_t symbol, uint64_t sequence) {
+        MarketMessage msg{};
+        msg.type      = MessageType::QUOTE;
+        msg.symbol_id = symbol;
+        msg.sequence  = sequence;
+        msg.quote.bid_price = 100.0;
+        msg.quote.ask_price = 100.1;
+        msg.quote.bid_qty   = 100;
+        msg.quote.ask_qty   = 100;
+        return msg;
+    }
+
+    // The socket path
+    void live(uint16_t symbol, uint64_t sequence) {
+        const MarketMessage msg = quote(symbol, sequence);
+        if (fh->check_sequence(msg)) {
+            fh->on_message(msg);
+        }
+    }
+
+    // A conflating server's notice that it withheld the symbol up to sequence
+    void gap_fill(uint16_t symbol, uint64_t sequence) {
+        MarketMessage msg{};
+        msg.type      = MessageType::GAP_FILL;
+        msg.symbol_id = symbol;
+        msg.sequence  = sequence;
+        CHECK(!fh->check_sequence(msg));   // carries no data to apply
+    }
+
+    // Server side of the recovery channel
+    void replay(uint16_t symbol, uint64_t sequence) {
+        reply(quote(symbol, sequence));
+    }
+
+    void range_end(uint16_t symbol) {
+        MarketMessage end{};
+        end.type      = MessageType::RETRANSMIT_END;
+        end.symbol_id = symbol;
+        reply(end);
+    }
+
+    void reply(const MarketMessage& msg) {
+        if (server_fd < 0) {
+            server_fd = accept(listen_fd, nullptr, nullptr);
+        }
+        const MarketMessage wire = to_wire(msg);
+        CHECK(send(server_fd, &wire, sizeof(wire), 0) == static_cast<ssize_t>(sizeof(wire)));
+
+        // Loopback delivery is not synchronous with send()
+        pollfd pfd{fh->recovery_.fd(), POLLIN, 0};
+        CHECK(poll(&pfd, 1, 1000) == 1);
+        fh->recovery_.on_event(EPOLLIN | EPOLLOUT);
+    }
+
+    // Sequence of the symbol's cached tick, 0 if none was applied
+    uint64_t latest(uint16_t symbol) const {
+        const FeedHandler& reader = *fh;
+        MarketMessage msg{};
+        return reader.get_latest(symbol, msg) ? msg.sequence : 0;
+    }
+
+    size_t held(uint16_t symbol) const { return fh->held_[symbol].size(); }
+    uint32_t pending(uint16_t symbol) const { return fh->pending_ranges_[symbol]; }
+    static size_t max_held() { return FeedHandler::MAX_HELD; }
+    void disconnect() { fh->on_disconnect("test disconnect"); }
+
+    // As the network thread applies them; offline, nothing is sent
+    void subscribe(uint16_t symbol) {
+        fh->subscribe({symbol});
+        fh->apply_subscription_changes();
+    }
+    void unsubscribe(uint16_t symbol) {
+        fh->unsubscribe({symbol});
+        fh->apply_subscription_changes();
+    }
+};
+
+namespace {
+
+constexpr uint16_t SYM = 7;
+
+void gap_filled_by_replay() {
+    FeedHandlerTest t;
+    t.live(SYM, 1);
+    t.live(SYM, 2);
+    t.live(SYM, 5);   // 3..4 missing: 5 is held behind the request
+    CHECK(t.latest(SYM) == 2);
+    CHECK(t.held(SYM) == 1);
+    CHECK(t.pending(SYM) == 1);
+    CHECK(t.fh->sequence_gaps() == 2);
+
+    t.replay(SYM, 3);
+    CHECK(t.latest(SYM) == 3);
+    t.replay(SYM, 4);
+    CHECK(t.latest(SYM) == 4);
+    t.range_end(SYM);
+    CHECK(t.latest(SYM) == 5);
+    CHECK(t.held(SYM) == 0);
+    CHECK(t.pending(SYM) == 0);
+
+    t.live(SYM, 6);
+    CHECK(t.latest(SYM) == 6);
+    CHECK(t.fh->recovered_count() == 2);
+    CHECK(t.fh->lost_count() == 0);
+    CHECK(t.fh->message_count() == 3);   // only the merge counts; live() bypasses the socket counters
+}
+
+// Two ranges out at once; held ticks go out between the replayed ones
+void replay_interleaved_with_held() {
+    FeedHandlerTest t;
+    t.live(SYM, 1);
+    t.live(SYM, 4);   // range 2..3
+    t.live(SYM, 5);
+    t.live(SYM, 7);   // range 6..6
+    CHECK(t.latest(SYM) == 1);
+    CHECK(t.held(SYM) == 3);
+    CHECK(t.pending(SYM) == 2);
+
+    t.replay(SYM, 2);
+    t.replay(SYM, 3);
+    CHECK(t.latest(SYM) == 3);
+    t.range_end(SYM);
+    CHECK(t.pending(SYM) == 1);
+    CHECK(t.latest(SYM) == 3);   // 4 and 5 still wait: the second range is open
+
+    t.replay(SYM, 6);            // 4 and 5 are older: applied first, then 6
+    CHECK(t.latest(SYM) == 6);
+    CHECK(t.held(SYM) == 1);
+    t.range_end(SYM);
+    CHECK(t.latest(SYM) == 7);
+    CHECK(t.pending(SYM) == 0);
+    CHECK(t.fh->lost_count() == 0);
+}
+
+// The replay came back short: what it missed stays lost, the held ticks
+// are applied anyway
+void range_end_with_missing_ticks() {
+    FeedHandlerTest t;
+    t.live(SYM, 1);
+    t.live(SYM, 6);   // range 2..5
+    t.replay(SYM, 3);
+    CHECK(t.latest(SYM) == 3);
+    t.range_end(SYM);
+    CHECK(t.latest(SYM) == 6);
+    CHECK(t.held(SYM) == 0);
+    CHECK(t.fh->recovered_count() == 1);
+    CHECK(t.fh->lost_count() == 3);
+
+    t.live(SYM, 7);
+    CHECK(t.latest(SYM) == 7);
+}
+
+// A symbol that holds MAX_HELD ticks stops waiting for its replay
+void max_held_overflow() {
+    FeedHandlerTest t;
+    t.live(SYM, 1);
+    t.live(SYM, 3);   // range 2..2
+    uint64_t seq = 4;
+    while (t.held(SYM) < FeedHandlerTest::max_held()) {
+        t.live(SYM, seq++);
+    }
+    CHECK(t.latest(SYM) == 1);
+    CHECK(t.pending(SYM) == 1);
+
+    t.live(SYM, seq);   // one too many: everything held goes out, then it
+    CHECK(t.latest(SYM) == seq);
+    CHECK(t.held(SYM) == 0);
+    CHECK(t.pending(SYM) == 0);
+
+    t.replay(SYM, 2);   // too late to be applied
+    t.range_end(SYM);
+    CHECK(t.latest(SYM) == seq);
+    CHECK(t.pending(SYM) == 0);
+}
+
+// A dead connection's held ticks are dropped, not applied, and its open
+// ranges end without releasing anything
+void disconnect_drops_held_ticks() {
+    FeedHandlerTest t;
+    t.live(SYM, 1);
+    t.live(SYM, 3);   // range 2..2
+    t.live(SYM, 4);
+    CHECK(t.held(SYM) == 2);
+
+    t.disconnect();
+    CHECK(t.held(SYM) == 0);
+    CHECK(t.pending(SYM) == 0);
+    CHECK(t.latest(SYM) == 1);
+    CHECK(t.fh->lost_count() == 1);
+}
+
+// Unsubscribing drops the symbol's held ticks and ends its ranges: the
+// replay that still comes back is ignored, and a later subscription starts
+// from whatever the server sends next
+void unsubscribe_drops_recovery_state() {
+    FeedHandlerTest t;
+    t.subscribe(SYM);
+    t.live(SYM, 1);
+    t.live(SYM, 3);   // range 2..2
+    t.live(SYM, 4);
+    CHECK(t.held(SYM) == 2);
+    CHECK(t.pending(SYM) == 1);
+
+    t.unsubscribe(SYM);
+    CHECK(t.held(SYM) == 0);
+    CHECK(t.pending(SYM) == 0);
+
+    t.replay(SYM, 2);
+    t.range_end(SYM);
+    CHECK(t.latest(SYM) == 1);
+    CHECK(t.fh->message_count() == 0);   // nothing went through the merge
+
+    t.subscribe(SYM);
+    t.live(SYM, 50);
+    CHECK(t.latest(SYM) == 50);
+    CHECK(t.pending(SYM) == 0);
+    CHECK(t.fh->sequence_gaps() == 1);   // only the original 2..2
+}
+
+// What a conflating server sends for a withheld symbol: a GAP_FILL up to
+// the latest quote, the quote, a GAP_FILL for what it withheld after it.
+// None of it is a gap, so nothing is requested or held
+void gap_fill_skips_withheld() {
+    FeedHandlerTest t;
+    t.live(SYM, 1);
+    t.gap_fill(SYM, 4);   // 2..4
+    t.live(SYM, 5);
+    t.gap_fill(SYM, 7);   // 6..7
+    t.live(SYM, 8);
+    CHECK(t.latest(SYM) == 8);
+    CHECK(t.fh->withheld_count() == 5);
+    CHECK(t.fh->sequence_gaps() == 0);
+    CHECK(t.pending(SYM) == 0);
+    CHECK(t.held(SYM) == 0);
+
+    // One already passed changes nothing
+    t.gap_fill(SYM, 6);
+    t.live(SYM, 9);
+    CHECK(t.latest(SYM) == 9);
+    CHECK(t.fh->withheld_count() == 5);
+    CHECK(t.fh->duplicate_count() == 0);
+
+    // A real gap after it is still one
+    t.live(SYM, 12);
+    CHECK(t.fh->sequence_gaps() == 2);
+    CHECK(t.pending(SYM) == 1);
+}
+
+// The first thing heard of a symbol can be its GAP_FILL: nothing counts as
+// withheld, the next tick is expected after it
+void gap_fill_first_of_symbol() {
+    FeedHandlerTest t;
+    t.gap_fill(SYM, 40);
+    CHECK(t.fh->withheld_count() == 0);
+    t.live(SYM, 41);
+    CHECK(t.latest(SYM) == 41);
+    CHECK(t.fh->sequence_gaps() == 0);
+}
+
+} // namespace
+
+int main() {
+    gap_filled_by_replay();
+    replay_interleaved_with_held();
+    range_end_with_missing_ticks();
+    max_held_overflow();
+    disconnect_drops_held_ticks();
+    unsubscribe_drops_recovery_state();
+    gap_fill_skips_withheld();
+    gap_fill_first_of_symbol();
+    return test_result("feed_handler_recovery_test");
+}
@@ -0,0 +1,111 @@
+#include "order_book.hpp"
+#include "test_check.hpp"
+
+namespace {
+
+uint64_t next_sequence = 1;
+
+MarketMessage quote(double bid, uint32_t bid_qty, double ask, uint32_t ask_qty) {
+    MarketMessage msg{};
+    msg.type = MessageType::QUOTE;
+    msg.sequence = next_sequence++;
+    msg.quote.bid_price = bid;
+    msg.quote.ask_price = ask;
+    msg.quote.bid_qty   = bid_qty;
+    msg.quote.ask_qty   = ask_qty;
+    return msg;
+}
+
+MarketMessage depth(BookSide side, uint8_t level, double price, uint32_t qty) {
+    MarketMessage msg{};
+    msg.type = MessageType::DEPTH;
+    msg.sequence = next_sequence++;
+    msg.depth.side  = side;
+    msg.depth.level = level;
+    msg.depth.price = price;
+    msg.depth.qty   = qty;
+    return msg;
+}
+
+MarketMessage trade(bool aggressor_buy, double price, uint32_t qty) {
+    MarketMessage msg{};
+    msg.type = MessageType::TRADE;
+    msg.sequence = next_sequence++;
+    msg.trade.aggressor_buy = aggressor_buy;
+    msg.trade.trade_price   = price;
+    msg.trade.trade_qty     = qty;
+    return msg;
+}
+
+// Two levels a side: 100.00 x 400 / 99.90 x 700 and 100.10 x 500 / 100.20 x 300
+OrderBook two_level_book() {
+    OrderBook book;
+    book.apply(quote(100.00, 400, 100.10, 500));
+    book.apply(depth(BookSide::BID, 1, 99.90, 700));
+    book.apply(depth(BookSide::ASK, 1, 100.20, 300));
+    return book;
+}
+
+// The trade price rarely equals the quoted level exactly (the server prices
+// it off the tick's evolved ask / bid): it still takes liquidity
+void trade_through_top_depletes_it() {
+    OrderBook book = two_level_book();
+    book.apply(trade(true, 100.12, 200));
+    CHECK(book.asks().qty[0] == 300);
+    CHECK(book.asks().price[0] == 100.10);
+    CHECK(book.asks().qty[1] == 300);   // 100.20 is past the trade price
+    CHECK(book.bids().qty[0] == 400);
+
+    book.apply(trade(false, 99.95, 150));
+    CHECK(book.bids().qty[0] == 250);
+    CHECK(book.bids().qty[1] == 700);
+    CHECK(book.asks().qty[0] == 300);
+}
+
+void trade_short_of_the_book_changes_nothing() {
+    OrderBook book = two_level_book();
+    book.apply(trade(true, 100.05, 100));    // below the best ask
+    book.apply(trade(false, 100.05, 100));   // above the best bid
+    CHECK(book.asks().qty[0] == 500);
+    CHECK(book.asks().qty[1] == 300);
+    CHECK(book.bids().qty[0] == 400);
+    CHECK(book.bids().qty[1] == 700);
+    CHECK(book.last_sequence() == next_sequence - 1);
+}
+
+void sweep_clears_every_crossed_level() {
+    OrderBook book = two_level_book();
+    book.apply(trade(true, 100.20, 1000));
+    CHECK(book.asks().count == 0);
+    CHECK(book.asks().qty[0] == 0);
+
+    // Partly into the second level; the emptied top keeps its slot
+    book = two_level_book();
+    book.apply(trade(false, 99.90, 600));
+    CHECK(book.bids().qty[0] == 0);
+    CHECK(book.bids().qty[1] == 500);
+    CHECK(book.bids().price[1] == 99.90);
+    CHECK(book.bids().count == 2);
+
+    // The next quote refills the top
+    book.apply(quote(99.95, 100, 100.10, 500));
+    CHECK(book.bids().qty[0] == 100);
+    CHECK(book.bids().qty[1] == 500);
+}
+
+void trade_on_empty_side_is_ignored() {
+    OrderBook book;
+    book.apply(trade(true, 100.0, 10));
+    CHECK(book.asks().count == 0);
+    CHECK(book.bids().count == 0);
+}
+
+} // namespace
+
+int main() {
+    trade_through_top_depletes_it();
+    trade_short_of_the_book_changes_nothing();
+    sweep_clears_every_crossed_level();
+    trade_on_empty_side_is_ignored();
+    return test_result("order_book_test");
+}
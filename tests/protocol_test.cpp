@@ -0,0 +1,381 @@
+#include "parser.hpp"
+#include "stream_buffer.hpp"
+#include "test_check.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Deterministic messages of every type; prices on the v2 fixed-point grid
+struct MessageGen {
+    uint64_t state{0x9E3779B97F4A7C15ULL};
+    uint64_t sequence{0};
+
+    uint64_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    double price() { return 50.0 + static_cast<double>(next() % 1000000) / v2::PRICE_SCALE; }
+
+    MarketMessage make(MessageType type) {
+        MarketMessage msg{};
+        msg.type         = type;
+        msg.symbol_id    = static_cast<uint16_t>(1 + next() % 500);
+        msg.sequence     = ++sequence;
+        msg.timestamp_ns = 1'700'000'000'000'000'000ULL + next() % 1'000'000'000ULL;
+        switch (type) {
+            case MessageType::QUOTE:
+                msg.quote.bid_price = price();
+                msg.quote.ask_price = msg.quote.bid_price + 0.01;
+                msg.quote.bid_qty   = static_cast<uint32_t>(next());
+                msg.quote.ask_qty   = static_cast<uint32_t>(next());
+                break;
+            case MessageType::TRADE:
+                msg.trade.trade_price   = price();
+                msg.trade.trade_qty     = static_cast<uint32_t>(next());
+                msg.trade.aggressor_buy = next() & 1;
+                break;
+            case MessageType::DEPTH:
+                msg.depth.price = price();
+                msg.depth.qty   = static_cast<uint32_t>(next());
+                msg.depth.side  = (next() & 1) ? BookSide::ASK : BookSide::BID;
+                msg.depth.level = static_cast<uint8_t>(1 + next() % 9);
+                break;
+            default:
+                break;
+        }
+        return msg;
+    }
+
+    MarketMessage any() {
+        static const MessageType types[] = {MessageType::QUOTE, MessageType::QUOTE, MessageType::TRADE,
+                                            MessageType::DEPTH, MessageType::HEARTBEAT,
+                                            MessageType::RETRANSMIT_END};
+        return make(types[next() % (sizeof(types) / sizeof(types[0]))]);
+    }
+};
+
+bool same_price(double a, double b) {
+    return std::fabs(a - b) < 0.5 / v2::PRICE_SCALE;
+}
+
+// Field by field; exact unless the message went through v2 fixed point
+bool same(const MarketMessage& a, const MarketMessage& b, bool fixed_point = false) {
+    const auto price_eq = [fixed_point](double x, double y) {
+        return fixed_point ? same_price(x, y) : std::memcmp(&x, &y, sizeof(x)) == 0;
+    };
+    if (a.type != b.type || a.symbol_id != b.symbol_id || a.sequence != b.sequence ||
+        a.timestamp_ns != b.timestamp_ns) {
+        return false;
+    }
+    switch (a.type) {
+        case MessageType::QUOTE:
+            return price_eq(a.quote.bid_price, b.quote.bid_price) &&
+                   price_eq(a.quote.ask_price, b.quote.ask_price) &&
+                   a.quote.bid_qty == b.quote.bid_qty && a.quote.ask_qty == b.quote.ask_qty;
+        case MessageType::TRADE:
+            return price_eq(a.trade.trade_price, b.trade.trade_price) &&
+                   a.trade.trade_qty == b.trade.trade_qty &&
+                   a.trade.aggressor_buy == b.trade.aggressor_buy;
+        case MessageType::DEPTH:
+            return price_eq(a.depth.price, b.depth.price) && a.depth.qty == b.depth.qty &&
+                   a.depth.side == b.depth.side && a.depth.level == b.depth.level;
+        default:
+            return true;
+    }
+}
+
+void append_v1(std::vector<uint8_t>& stream, const MarketMessage& msg) {
+    const MarketMessage wire = to_wire(msg);
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&wire);
+    stream.insert(stream.end(), bytes, bytes + sizeof(wire));
+}
+
+void append_v2(std::vector<uint8_t>& stream, const MarketMessage& msg) {
+    uint8_t frame[v2::MAX_FRAME];
+    const size_t len = v2::encode(msg, frame);
+    stream.insert(stream.end(), frame, frame + len);
+}
+
+void v1_round_trip() {
+    MessageGen gen;
+    Parser parser;
+    for (int i = 0; i < 1000; ++i) {
+        const MarketMessage msg = gen.any();
+        CHECK(same(from_wire(to_wire(msg)), msg));
+
+        std::vector<uint8_t> bytes;
+        append_v1(bytes, msg);
+        const ParseResult r = parser.parse(bytes.data(), bytes.size());
+        CHECK(r.status == ParseStatus::OK);
+        CHECK(r.bytes_consumed == sizeof(MarketMessage));
+        CHECK(same(r.message, msg));
+    }
+}
+
+void v2_round_trip() {
+    MessageGen gen;
+    Parser parser;
+    for (int i = 0; i < 1000; ++i) {
+        const MarketMessage msg = gen.any();
+        uint8_t frame[v2::MAX_FRAME];
+        const size_t len = v2::encode(msg, frame);
+        CHECK(len == v2::frame_size(msg.type));
+        CHECK(frame[0] != 0);   // never mistaken for v1
+
+        MarketMessage out;
+        CHECK(v2::decode(frame, len, out));
+        CHECK(same(out, msg, true));
+
+        const ParseResult r = parser.parse(frame, len);
+        CHECK(r.status == ParseStatus::OK);
+        CHECK(r.bytes_consumed == len);
+        CHECK(same(r.message, msg, true));
+
+        // Cut short it is incomplete, not malformed
+        CHECK(parser.parse(frame, len - 1).status == ParseStatus::INCOMPLETE);
+    }
+    CHECK(!parser.malformed());
+
+    // A length that fits no frame cannot be resynchronised
+    uint8_t bad[v2::MAX_FRAME] = {3, 0};
+    CHECK(parser.parse(bad, sizeof(bad)).status == ParseStatus::MALFORMED);
+    CHECK(parser.malformed());
+}
+
+// Mixed v1 / v2 stream fed through a StreamBuffer in odd-sized reads, so
+// frames straddle every read boundary
+void frames_split_across_reads() {
+    MessageGen gen;
+    std::vector<MarketMessage> sent;
+    std::vector<uint8_t> stream;
+    for (int i = 0; i < 2000; ++i) {
+        const MarketMessage msg = gen.any();
+        sent.push_back(msg);
+        if (gen.next() & 1) {
+            append_v2(stream, msg);
+        } else {
+            append_v1(stream, msg);
+        }
+    }
+
+    static const size_t reads[] = {1, 3, 7, 13, 44, 61, 5, 200, 2};
+    StreamBuffer buffer(64 * 1024);
+    Parser parser;
+    size_t received = 0;
+    bool in_order = true;
+    size_t off = 0;
+    for (size_t r = 0; off < stream.size(); ++r) {
+        size_t n = reads[r % (sizeof(reads) / sizeof(reads[0]))];
+        if (n > stream.size() - off) {
+            n = stream.size() - off;
+        }
+        CHECK(buffer.append(stream.data() + off, n));
+        off += n;
+
+        const size_t consumed = parser.parse_batch(
+            buffer.data_ptr(), buffer.data_size(),
+            [&](const MarketMessage& msg) {
+                if (received >= sent.size() || !same(msg, sent[received], true)) {
+                    in_order = false;
+                }
+                ++received;
+            });
+        buffer.consume(consumed);
+    }
+    CHECK(in_order);
+    CHECK(received == sent.size());
+    CHECK(buffer.data_size() == 0);
+    CHECK(!parser.malformed());
+}
+
+// parse_batch byte-swaps runs of v1 messages on SIMD lanes where the CPU
+// has them; parse() and from_wire() are the scalar reference
+void simd_matches_scalar() {
+    MessageGen gen;
+    std::vector<uint8_t> stream;
+    for (int i = 0; i < 4096; ++i) {
+        append_v1(stream, gen.any());
+    }
+
+    Parser parser;
+    std::vector<MarketMessage> batch(stream.size() / sizeof(MarketMessage));
+    size_t consumed = 0;
+    const size_t n = parser.parse_batch(stream.data(), stream.size(), batch.data(), batch.size(), consumed);
+    CHECK(n == batch.size());
+    CHECK(consumed == stream.size());
+
+    for (size_t i = 0; i < n; ++i) {
+        const uint8_t* bytes = stream.data() + i * sizeof(MarketMessage);
+        const ParseResult scalar = parser.parse(bytes, sizeof(MarketMessage));
+        MarketMessage wire;
+        std::memcpy(&wire, bytes, sizeof(wire));
+        CHECK(same(batch[i], scalar.message));
+        CHECK(same(batch[i], from_wire(wire)));
+    }
+
+    // A trailing partial message is left for the next read
+    const size_t n2 = parser.parse_batch(stream.data(), 3 * sizeof(MarketMessage) - 1,
+                                         batch.data(), batch.size(), consumed);
+    CHECK(n2 == 2);
+    CHECK(consumed == 2 * sizeof(MarketMessage));
+}
+
+// One batch as the server builds it: the first message sets the base, each
+// frame goes compact where encode_batched() allows. server_last is the
+// connection's sequence state on the server side; compact counts the
+// compact frames
+std::vector<uint8_t> make_batch(const std::vector<MarketMessage>& msgs,
+                                std::vector<uint64_t>& server_last, size_t& compact) {
+    const uint64_t base = msgs.front().timestamp_ns;
+    std::vector<uint8_t> batch(sizeof(v2::BatchHeader));   // header filled in last
+    compact = 0;
+    for (const MarketMessage& msg : msgs) {
+        uint8_t frame[v2::MAX_FRAME];
+        uint8_t out[v2::MAX_FRAME];
+        const size_t len = v2::encode(msg, frame);
+        const size_t clen = v2::encode_batched(frame, len, base, server_last.data(), out);
+        if (clen != 0) {
+            batch.insert(batch.end(), out, out + clen);
+            ++compact;
+        } else {
+            batch.insert(batch.end(), frame, frame + len);
+        }
+    }
+    const v2::BatchHeader header = v2::make_batch_header(
+        static_cast<uint16_t>(msgs.size()), static_cast<uint32_t>(batch.size() - sizeof(v2::BatchHeader)),
+        base, base);
+    std::memcpy(batch.data(), &header, sizeof(header));
+    return batch;
+}
+
+// Every message of the batches comes back out of one Parser, in order
+bool parses_back(const std::vector<std::vector<uint8_t>>& batches,
+                 const std::vector<MarketMessage>& sent) {
+    Parser parser;
+    size_t received = 0;
+    bool in_order = true;
+    for (const std::vector<uint8_t>& batch : batches) {
+        const size_t consumed = parser.parse_batch(
+            batch.data(), batch.size(),
+            [&](const MarketMessage& msg) {
+                if (received >= sent.size() || !same(msg, sent[received], true)) {
+                    in_order = false;
+                }
+                ++received;
+            });
+        in_order = in_order && consumed == batch.size();
+    }
+    return in_order && received == sent.size() && !parser.malformed();
+}
+
+MarketMessage tick(uint16_t symbol, uint64_t sequence, uint64_t timestamp_ns) {
+    MessageGen gen;
+    MarketMessage msg = gen.make(MessageType::QUOTE);
+    msg.symbol_id    = symbol;
+    msg.sequence     = sequence;
+    msg.timestamp_ns = timestamp_ns;
+    return msg;
+}
+
+// Replays and late ticks move a symbol's sequence and a frame's timestamp
+// backwards: both deltas are signed
+void compact_negative_deltas() {
+    constexpr uint64_t T = 1'700'000'000'000'000'000ULL;
+    const std::vector<MarketMessage> msgs = {
+        tick(5, 1000, T),
+        tick(5, 1010, T + 200),
+        tick(5, 995,  T - 500),        // sequence -15, timestamp -500 ns
+        tick(5, 996,  T + 100),
+        tick(9, 42,   T),
+        tick(9, 10,   T - 32'000'000), // sequence -32, timestamp -32 ms
+    };
+    std::vector<uint64_t> server_last(v2::SEQUENCE_SLOTS);
+    size_t compact = 0;
+    const std::vector<uint8_t> batch = make_batch(msgs, server_last, compact);
+    CHECK(compact == 4);   // all but each symbol's first
+    CHECK(server_last[5] == 996);
+    CHECK(server_last[9] == 10);
+
+    // The third frame's header carries the negative deltas as they are
+    const size_t third = sizeof(v2::BatchHeader) + sizeof(v2::Quote) +
+                         (sizeof(v2::Quote) - sizeof(v2::Header) + sizeof(v2::CompactHeader));
+    v2::CompactHeader c;
+    std::memcpy(&c, batch.data() + third, sizeof(c));
+    CHECK((c.type & v2::COMPACT_FLAG) != 0);
+    CHECK(static_cast<int16_t>(le16toh(static_cast<uint16_t>(c.sequence_delta))) == -15);
+    CHECK(static_cast<int32_t>(le32toh(static_cast<uint32_t>(c.timestamp_delta))) == -500);
+
+    CHECK(parses_back({batch}, msgs));
+}
+
+// Deltas past int16 / int32, a symbol's first frame and ids without a
+// sequence slot go as full v2 frames; the sequence state still follows them
+void compact_overflow_falls_back() {
+    constexpr uint64_t T = 1'700'000'000'000'000'000ULL;
+    const uint16_t far_symbol = static_cast<uint16_t>(v2::SEQUENCE_SLOTS + 3);
+    std::vector<uint64_t> last(v2::SEQUENCE_SLOTS);
+    uint8_t frame[v2::MAX_FRAME];
+    uint8_t out[v2::MAX_FRAME];
+    const auto batched = [&](const MarketMessage& msg) {
+        const size_t len = v2::encode(msg, frame);
+        return v2::encode_batched(frame, len, T, last.data(), out);
+    };
+
+    CHECK(batched(tick(5, 1, T)) == 0);                         // first of its symbol
+    CHECK(last[5] == 1);
+    CHECK(batched(tick(5, 2, T)) != 0);
+    CHECK(batched(tick(5, 2 + INT16_MAX, T)) != 0);             // largest forward delta
+    CHECK(batched(tick(5, 3 + 2 * INT16_MAX, T)) == 0);         // one past it
+    CHECK(last[5] == 3 + 2 * INT16_MAX);
+    CHECK(batched(tick(5, 3 + INT16_MAX, T)) != 0);             // back by INT16_MAX
+    CHECK(batched(tick(5, 2, T)) != 0);                         // back by -INT16_MIN
+    CHECK(batched(tick(5, 40'000, T)) == 0);
+    CHECK(batched(tick(5, 40'000 + INT16_MIN - 1, T)) == 0);    // one past it
+    CHECK(last[5] == 40'000 + INT16_MIN - 1);
+    CHECK(batched(tick(5, 1, T + INT32_MAX)) != 0);             // latest timestamp
+    CHECK(batched(tick(5, 2, T + INT32_MAX + 1ULL)) == 0);      // one past it
+    CHECK(batched(tick(5, 3, T - (1ULL << 31))) != 0);          // earliest
+    CHECK(batched(tick(5, 4, T - (1ULL << 31) - 1)) == 0);      // one before it
+    CHECK(last[5] == 4);
+    CHECK(batched(tick(far_symbol, 1, T)) == 0);
+    CHECK(batched(tick(far_symbol, 2, T)) == 0);                // no slot, never compact
+
+    // The same cases in batches, through the parser
+    const std::vector<MarketMessage> first = {
+        tick(5, 1, T), tick(5, 40'000, T + 10), tick(5, 40'001, T + 20),
+        tick(5, 1, T + 3'000'000'000ULL), tick(5, 2, T + 30),
+        tick(far_symbol, 7, T), tick(far_symbol, 8, T),
+    };
+    const std::vector<MarketMessage> second = {
+        tick(5, 3, T + 40), tick(far_symbol, 9, T + 40),
+    };
+    std::vector<uint64_t> server_last(v2::SEQUENCE_SLOTS);
+    size_t compact = 0;
+    std::vector<std::vector<uint8_t>> batches;
+    batches.push_back(make_batch(first, server_last, compact));
+    CHECK(compact == 2);   // 40'001 after the full 40'000 frame, and 2 after 1
+    batches.push_back(make_batch(second, server_last, compact));
+    CHECK(compact == 1);   // the next batch picks up from the first's state
+
+    std::vector<MarketMessage> sent = first;
+    sent.insert(sent.end(), second.begin(), second.end());
+    CHECK(parses_back(batches, sent));
+}
+
+} // namespace
+
+int main() {
+    v1_round_trip();
+    v2_round_trip();
+    frames_split_across_reads();
+    simd_matches_scalar();
+    compact_negative_deltas();
+    compact_overflow_falls_back();
+    return test_result("protocol_test");
+}
@@ -0,0 +1,32 @@
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <cstdio>
+
+// Minimal checks for the ctest executables: a failed CHECK prints where it
+// failed and the test carries on; main returns test_result(), non-zero if
+// anything failed. Unlike assert() it still checks in release builds.
+inline int& test_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n",                \
+                         __FILE__, __LINE__, #cond);                         \
+            ++test_failures();                                               \
+        }                                                                    \
+    } while (0)
+
+inline int test_result(const char* name) {
+    if (test_failures() != 0) {
+        std::fprintf(stderr, "%s: %d check(s) failed\n", name, test_failures());
+        return 1;
+    }
+    std::printf("%s: ok\n", name);
+    return 0;
+}
+
+#endif